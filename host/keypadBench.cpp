@@ -0,0 +1,470 @@
+/**
+ * @file                    keypadBench.cpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Replays bounce traces against every mode of the Keypad on the host, and reports the events
+ *                          per second, the time spent in interrupts per edge, and the detection latency
+ * @remark                  In KeypadMode::EXTERNAL_SCAN, a stand-in for a DMA captures every pass over the matrix into a
+ *                          KeypadScanCapture, and passes the converted scan to the keypad
+ *
+ * @remark                  Usage: keypad-bench [--check] [--dump] [trace]
+ *                          , without a trace, a synthetic trace of bouncing presses (from a fixed seed) is replayed
+ *                          , --check fails the run if any mode reports a different number of presses or releases than
+ *                          the trace contains, or drops an event
+ *                          , --dump prints the synthetic trace instead of replaying it
+ * @remark                  The library is built with KEYPAD_ISR_STATS, so the time spent in each handler is reported as
+ *                          well (the cycle counter of the host counts nanoseconds)
+ * @remark                  A trace has one edge per line, as the time (in microseconds), the row and column of the button
+ *                          and its new level (1 for held down), and lines starting with '#' are ignored
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include "keypad.h"
+#include "keypadHost.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t  NumRows     = 4;
+constexpr uint32_t  NumCols     = 4;
+
+/** Number of presses in the synthetic trace */
+constexpr uint32_t  SYNTHETIC_PRESSES   = 1000;
+/** Shortest time (in microseconds) for which a level must be stable to count as a press or release in the trace */
+constexpr uint64_t  STABLE_US           = 60000;
+
+const PinName       rowPins[NumRows]    = {0, 1, 2, 3};
+const PinName       colPins[NumCols]    = {10, 11, 12, 13};
+
+/** Port that all the pins of the rows and columns belong to (for the port-mapped backend) */
+constexpr PortName  MatrixPort          = 0;
+
+/** Single edge of a trace */
+struct Edge {
+    uint64_t        us;
+    uint32_t        r;
+    uint32_t        c;
+    bool            down;
+};
+
+/** Result of replaying a trace against one mode */
+struct Result {
+    uint32_t        events;
+    uint32_t        presses;
+    uint32_t        releases;
+    uint32_t        latencyCount;
+    uint64_t        latencyMinUs;
+    uint64_t        latencyMaxUs;
+    uint64_t        latencyTotalUs;
+    double          wallSeconds;
+    sim::IsrStats   isr;
+    keypad_counters counters;
+    keypad_isr_stats handlers[KEYPAD_ISR_COUNT];
+};
+
+/** Names of the profiled handlers, indexed by KeypadIsr */
+const char *const   handlerNames[KEYPAD_ISR_COUNT] = {
+    "fall", "rise", "row-scan", "eager-verify", "button-scan", "long-press", "repeat", "matrix-edge", "matrix-scan",
+    "periodic-scan", "external-scan"
+};
+
+/**
+ * @brief                   Returns the next number of a linear congruential generator (the same on every host)
+ *
+ */
+uint32_t
+next_random(uint32_t &state) {
+
+    state = state * 1664525U + 1013904223U;
+    return state >> 8;
+}
+
+/**
+ * @brief                   Appends a burst of bounces that settles at a level to a trace
+ *
+ */
+void
+add_bounces(std::vector<Edge> &trace, uint64_t &us, uint32_t r, uint32_t c, bool down, uint32_t &seed) {
+
+    // an odd number of edges (at most 7) that are 100 to 2000 microseconds apart, ending at the settled level
+
+    const uint32_t edges = 1 + 2 * (next_random(seed) % 4);
+
+    for (uint32_t i = 0; i < edges; ++i) {
+
+        trace.push_back({us, r, c, (i % 2 == 0) ? down : !down});
+        us += 100 + next_random(seed) % 1900;
+    }
+}
+
+/**
+ * @brief                   Generates a trace of bouncing presses of random buttons, one at a time
+ *
+ */
+std::vector<Edge>
+synthetic_trace(uint32_t presses, uint32_t seed) {
+
+    // the buttons are held for 80 to 800 milliseconds (so that some are long-pressed), with 100 to 300 milliseconds
+    // between them
+
+    std::vector<Edge> trace;
+    uint64_t us = 100000;
+
+    for (uint32_t i = 0; i < presses; ++i) {
+
+        const uint32_t r = next_random(seed) % NumRows;
+        const uint32_t c = next_random(seed) % NumCols;
+
+        const uint64_t start = us;
+        add_bounces(trace, us, r, c, true, seed);
+        us = start + 1000 * (80 + next_random(seed) % 720);
+
+        const uint64_t release = us;
+        add_bounces(trace, us, r, c, false, seed);
+        us = release + 1000 * (100 + next_random(seed) % 200);
+    }
+
+    return trace;
+}
+
+/**
+ * @brief                   Reads a trace from a file
+ *
+ */
+bool
+read_trace(const char *path, std::vector<Edge> &trace) {
+
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof line, f) != nullptr) {
+
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        unsigned long long us;
+        unsigned r, c, down;
+
+        if (sscanf(line, "%llu %u %u %u", &us, &r, &c, &down) != 4 || r >= NumRows || c >= NumCols) {
+            fclose(f);
+            return false;
+        }
+
+        trace.push_back({us, r, c, down != 0});
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief                   Finds the presses in a trace, ignoring the levels that are not stable for long enough
+ *
+ * @return                  Number of presses that were released by the end of the trace
+ *
+ */
+uint32_t
+find_presses(const std::vector<Edge> &trace, std::vector<uint64_t> (&starts)[NumRows * NumCols]) {
+
+    // a level only counts once it has been stable for STABLE_US, which is what a correct debouncer reports, and a press
+    // starts at the first edge that left the stable released level
+    // the last level of each button is stable forever
+
+    uint32_t releases = 0;
+
+    for (uint32_t k = 0; k < NumRows * NumCols; ++k) {
+
+        bool stable = false;
+        bool level = false;
+        uint64_t since = 0;
+        uint64_t left = 0;
+
+        starts[k].clear();
+
+        for (const auto &e : trace) {
+
+            if (e.r * NumCols + e.c != k) {
+                continue;
+            }
+
+            if (level != stable && e.us - since >= STABLE_US) {
+                stable = level;
+                if (stable) {
+                    starts[k].push_back(left);
+                }
+            }
+
+            if (level == stable && e.down != stable) {
+                left = e.us;
+            }
+
+            level = e.down;
+            since = e.us;
+        }
+
+        if (level && !stable) {
+            starts[k].push_back(left);
+        }
+
+        releases += starts[k].size() - (level ? 1 : 0);
+    }
+
+    return releases;
+}
+
+/**
+ * @brief                   Stand-in for a DMA that captures a pass over the matrix into a KeypadScanCapture every scan
+ *                          period, after which the scan is passed to a keypad in KeypadMode::EXTERNAL_SCAN
+ *
+ */
+struct ScanDma {
+
+    /** Keypad that processes the scans */
+    Keypad<NumRows, NumCols, KeypadPortIO> &keypad;
+    /** Buffers of the transfers */
+    KeypadScanCapture<NumRows, NumCols> capture {keypad.get_io()};
+    /** Output register of the rows (the destination of the transfers from the row values) */
+    PortOut             rows {MatrixPort, static_cast<int>(keypad.get_io().get_row_mask())};
+    /** Input register of the columns (the source of the transfers to the samples) */
+    PortIn              cols {MatrixPort, static_cast<int>(keypad.get_io().get_col_mask())};
+    /** Timer that triggers each pass */
+    Ticker              trigger;
+
+    explicit ScanDma(Keypad<NumRows, NumCols, KeypadPortIO> &scanned) : keypad(scanned) {}
+
+    /**
+     * @brief               Runs one pass, and converts and processes the scan once it is complete
+     *
+     */
+    void pass() {
+
+        auto *samples = capture.get_samples();
+        for (uint32_t i = 0; i < NumRows; ++i) {
+
+            rows.write(static_cast<int>(capture.get_row_values()[i]));
+            samples[i] = static_cast<uint32_t>(cols.read());
+        }
+
+        capture.update();
+        keypad.process_scan(capture.get_frame());
+    }
+};
+
+/**
+ * @brief                   Replays a trace against a keypad
+ *
+ */
+template <typename K>
+Result
+run(const std::vector<Edge> &trace, const std::vector<uint64_t> (&starts)[NumRows * NumCols], K &keypad) {
+
+    static Result result;
+    static const std::vector<uint64_t> (*pressStarts)[NumRows * NumCols];
+    static uint32_t pressIndex[NumRows * NumCols];
+
+    result = Result {};
+    result.latencyMinUs = UINT64_MAX;
+    pressStarts = &starts;
+
+    for (auto &i : pressIndex) {
+        i = 0;
+    }
+
+    // the latency of the n-th press of a button is measured from the start of its n-th press in the trace
+
+    keypad.register_onevent([](keypad_event e) {
+
+        const auto k = e.r * NumCols + e.c;
+
+        ++result.events;
+
+        if (keypad_event_type(e) == KeypadEventType::PRESS) {
+
+            ++result.presses;
+
+            const auto &s = (*pressStarts)[k];
+            if (pressIndex[k] < s.size()) {
+
+                const auto us = sim::now_us - s[pressIndex[k]++];
+
+                ++result.latencyCount;
+                result.latencyTotalUs += us;
+                result.latencyMinUs = (us < result.latencyMinUs) ? us : result.latencyMinUs;
+                result.latencyMaxUs = (us > result.latencyMaxUs) ? us : result.latencyMaxUs;
+            }
+        }
+        else if (keypad_event_type(e) == KeypadEventType::RELEASE) {
+            ++result.releases;
+        }
+    });
+
+    keypad.initialize();
+    keypad.reset_isr_stats();
+    sim::reset_isr_stats();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto &e : trace) {
+
+        if (e.us > sim::now_us) {
+            sim::advance(std::chrono::microseconds(e.us - sim::now_us));
+        }
+
+        sim::matrix.set(rowPins[e.r], colPins[e.c], e.down);
+    }
+
+    sim::advance(std::chrono::seconds(1));
+
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.isr = sim::isr;
+
+    keypad.get_counters(&result.counters);
+    keypad.get_isr_stats(&result.handlers);
+    keypad.finalize();
+
+    return result;
+}
+
+/**
+ * @brief                   Replays a trace against a new keypad in a mode
+ *
+ * @remark                  In KeypadMode::EXTERNAL_SCAN, the keypad uses the port-mapped backend, and its scans are
+ *                          captured by a ScanDma
+ *
+ */
+Result
+replay(const std::vector<Edge> &trace, const std::vector<uint64_t> (&starts)[NumRows * NumCols], KeypadMode mode) {
+
+    // every replay starts from the same time with every button released
+
+    sim::now_us = 0;
+    sim::matrix.pressed.clear();
+    sim::pins_changed();
+
+    if (mode == KeypadMode::EXTERNAL_SCAN) {
+
+        Keypad<NumRows, NumCols, KeypadPortIO> keypad(MatrixPort, MatrixPort, rowPins, colPins, mode);
+        ScanDma dma(keypad);
+
+        dma.trigger.attach(callback(&dma, &ScanDma::pass), MATRIX_SCAN_PERIOD);
+        return run(trace, starts, keypad);
+    }
+
+    Keypad<NumRows, NumCols> keypad(rowPins, colPins, mode);
+    return run(trace, starts, keypad);
+}
+
+} // namespace
+
+int
+main(int argc, char **argv) {
+
+    bool check = false;
+    bool dump = false;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+
+        if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        }
+        else if (strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    std::vector<Edge> trace;
+
+    if (path == nullptr) {
+        trace = synthetic_trace(SYNTHETIC_PRESSES, 1);
+    }
+    else if (!read_trace(path, trace)) {
+        fprintf(stderr, "could not read the trace from %s\n", path);
+        return 2;
+    }
+
+    if (dump) {
+
+        printf("# time (us), row, column, level\n");
+        for (const auto &e : trace) {
+            printf("%" PRIu64 " %u %u %d\n", e.us, e.r, e.c, e.down ? 1 : 0);
+        }
+        return 0;
+    }
+
+    static std::vector<uint64_t> starts[NumRows * NumCols];
+    const uint32_t releases = find_presses(trace, starts);
+
+    uint32_t presses = 0;
+    for (const auto &s : starts) {
+        presses += s.size();
+    }
+
+    printf("%zu edges, %u presses, %u releases\n\n", trace.size(), presses, releases);
+    printf("%-14s %8s %8s %8s %12s %10s %26s\n", "mode", "events", "presses", "releases", "events/s", "isr ns/edge",
+           "latency us (min/avg/max)");
+
+    const struct {
+        const char  *name;
+        KeypadMode  mode;
+    } modes[] = {
+        {"single-key", KeypadMode::SINGLE_KEY},
+        {"rollover", KeypadMode::ROLLOVER},
+        {"periodic-scan", KeypadMode::PERIODIC_SCAN},
+        {"external-scan", KeypadMode::EXTERNAL_SCAN},
+    };
+
+    bool ok = true;
+    Result results[sizeof modes / sizeof modes[0]];
+
+    for (uint32_t i = 0; i < sizeof modes / sizeof modes[0]; ++i) {
+
+        const auto &m = modes[i];
+        const auto &r = results[i] = replay(trace, starts, m.mode);
+
+        printf("%-14s %8u %8u %8u %12.0f %10.0f %8" PRIu64 " /%8" PRIu64 " /%8" PRIu64 "\n", m.name, r.events,
+               r.presses, r.releases, r.events / r.wallSeconds, double(r.isr.totalNs) / trace.size(),
+               r.latencyCount ? r.latencyMinUs : 0, r.latencyCount ? r.latencyTotalUs / r.latencyCount : 0,
+               r.latencyMaxUs);
+
+        if (r.presses != presses || r.releases != releases || r.counters.dropped != 0) {
+            ok = false;
+        }
+    }
+
+    // only the handlers that ran in a mode are listed under it
+
+    printf("\n%-14s %-14s %10s %10s %10s\n", "mode", "handler", "runs", "avg ns", "max ns");
+
+    for (uint32_t i = 0; i < sizeof modes / sizeof modes[0]; ++i) {
+        for (uint32_t h = 0; h < KEYPAD_ISR_COUNT; ++h) {
+
+            const auto &s = results[i].handlers[h];
+            if (s.count == 0) {
+                continue;
+            }
+
+            printf("%-14s %-14s %10u %10" PRIu64 " %10u\n", modes[i].name, handlerNames[h], s.count, s.total / s.count,
+                   s.max);
+        }
+    }
+
+    if (check && !ok) {
+        fprintf(stderr, "\nthe keypad did not report every press and release in the trace exactly once\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file                    keypadGhostTest.cpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Checks on the host that three buttons held down on the corners of a rectangle of a matrix
+ *                          without diodes do not report the ghost on the fourth corner, in every per-button mode
+ *
+ * @remark                  Usage: keypad-ghost-test (fails the run if a mode reports a ghost or does not count it)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include "keypad.h"
+#include "keypadHost.h"
+
+#include <cstdio>
+
+namespace {
+
+constexpr uint32_t  NumRows     = 4;
+constexpr uint32_t  NumCols     = 4;
+
+const PinName       rowPins[NumRows]    = {0, 1, 2, 3};
+const PinName       colPins[NumCols]    = {10, 11, 12, 13};
+
+/** Bitmask of the buttons that were reported as pressed, and of those that were reported as released */
+uint32_t            pressed;
+uint32_t            released;
+/** Bitmask of the buttons that were reported as pressed while all of them were held down */
+uint32_t            pressedHeld;
+
+/**
+ * @brief                   Holds down the corners (0, 0), (0, 1) and (1, 0) of a rectangle one after another, along
+ *                          with (3, 3) on a row and column of its own, and releases them all in the same order
+ *
+ * @param diodeless         Whether the simulated matrix has no diodes (in which case (1, 1) reads as held down too)
+ * @param ghosts            Location where the number of suppressed ghosts is stored
+ *
+ */
+void
+hold_rectangle(KeypadMode mode, bool diodeless, uint32_t &ghosts) {
+
+    pressed = released = 0;
+
+    sim::now_us = 0;
+    sim::matrix.pressed.clear();
+    sim::matrix.diodeless = diodeless;
+    sim::pins_changed();
+
+    Keypad<NumRows, NumCols> keypad(rowPins, colPins, mode);
+
+    keypad.set_diodes(!diodeless);
+    keypad.register_onpress([](uint32_t r, uint32_t c) { pressed |= 1U << (r * NumCols + c); });
+    keypad.register_onrelease([](uint32_t r, uint32_t c) { released |= 1U << (r * NumCols + c); });
+    keypad.initialize();
+
+    const uint32_t keys[][2] = {{0, 0}, {0, 1}, {1, 0}, {3, 3}};
+
+    for (const auto &k : keys) {
+
+        sim::matrix.set(rowPins[k[0]], colPins[k[1]], true);
+        sim::advance(std::chrono::milliseconds(100));
+    }
+
+    pressedHeld = pressed;
+
+    for (const auto &k : keys) {
+
+        sim::matrix.set(rowPins[k[0]], colPins[k[1]], false);
+        sim::advance(std::chrono::milliseconds(100));
+    }
+
+    keypad_counters counters;
+    keypad.get_counters(&counters);
+    ghosts = counters.ghostsSuppressed;
+
+    keypad.finalize();
+    sim::matrix.diodeless = false;
+}
+
+/** Returns the bit of a button in the bitmasks of reported buttons */
+constexpr uint32_t
+key(uint32_t r, uint32_t c) {
+    return 1U << (r * NumCols + c);
+}
+
+} // namespace
+
+int
+main() {
+
+    const struct {
+        const char  *name;
+        KeypadMode  mode;
+    } modes[] = {
+        {"rollover", KeypadMode::ROLLOVER},
+        {"periodic-scan", KeypadMode::PERIODIC_SCAN},
+    };
+
+    bool ok = true;
+
+    for (const auto &m : modes) {
+
+        uint32_t ghosts;
+
+        // with diodes every button is reported, and nothing is suppressed
+
+        hold_rectangle(m.mode, false, ghosts);
+        printf("%-14s diodes     pressed 0x%04x released 0x%04x ghosts %u\n", m.name, pressed, released, ghosts);
+
+        const uint32_t all = key(0, 0) | key(0, 1) | key(1, 0) | key(3, 3);
+        if (pressed != all || released != all || ghosts != 0) {
+            ok = false;
+        }
+
+        // without diodes the third corner makes the combination ambiguous, so neither it nor the ghost on (1, 1) is
+        // reported while all of them are held down (the button outside the rectangle still is), and the third corner
+        // is only accepted once releasing the first one resolves the combination
+
+        hold_rectangle(m.mode, true, ghosts);
+        printf("%-14s no diodes  pressed 0x%04x (0x%04x while held) released 0x%04x ghosts %u\n", m.name, pressed,
+               pressedHeld, released, ghosts);
+
+        if (pressedHeld != (key(0, 0) | key(0, 1) | key(3, 3)) || pressed != all || released != all || ghosts == 0) {
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "\nthe keypad reported a ghost, or did not count its suppression\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "keypadHost.h"
+
+uint32_t                            SystemCoreClock {1000000000U};
+
+namespace sim {
+
+uint64_t                            now_us {0};
+std::map<PinName, Pin>              pins;
+std::vector<InterruptIn *>          interrupts;
+std::vector<events::EventQueue *>   queues;
+int                                 critical_depth {0};
+
+Matrix                              matrix;
+IsrStats                            isr {};
+
+namespace {
+
+/** Function scheduled by a timer */
+struct Scheduled {
+    uint64_t                due;
+    uint64_t                seq;
+    const void              *owner;
+    std::function<void()>   fn;
+};
+
+/** Functions scheduled by the timers, in no particular order */
+std::vector<Scheduled>      timers;
+/** Number of functions scheduled so far (orders the functions that are due at the same time) */
+uint64_t                    timerSeq {0};
+
+/** Edges that were raised and are yet to run their interrupt, as the pin and its new level */
+std::vector<std::pair<InterruptIn *, int>> pendingEdges;
+/** Whether an interrupt is currently running (edges raised by it run after it returns) */
+bool                        inIsr {false};
+
+/**
+ * @brief                   Runs a function as an interrupt, and accounts the time spent in it
+ *
+ */
+template <typename F>
+void
+run_isr(F &&fn, uint64_t &counter) {
+
+    const auto start = std::chrono::steady_clock::now();
+
+    inIsr = true;
+    fn();
+    inIsr = false;
+
+    isr.totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    ++counter;
+}
+
+/**
+ * @brief                   Runs the interrupts of the edges that were raised, in order
+ *
+ */
+void
+process_edges() {
+
+    while (!pendingEdges.empty()) {
+
+        const auto e = pendingEdges.front();
+        pendingEdges.erase(pendingEdges.begin());
+
+        // the pin may have been destroyed or disabled since the edge was raised
+
+        if (std::find(interrupts.begin(), interrupts.end(), e.first) == interrupts.end() || !e.first->enabled) {
+            continue;
+        }
+
+        const auto &cb = (e.second == 0) ? e.first->fallCb : e.first->riseCb;
+        if (cb) {
+            run_isr(cb, isr.edges);
+        }
+    }
+}
+
+/**
+ * @brief                   Runs the calls pending on every event queue (only while no interrupt is running)
+ *
+ */
+void
+dispatch_queues() {
+
+    if (inIsr) {
+        return;
+    }
+
+    const auto current = queues;
+    for (auto *q : current) {
+        q->dispatch_once();
+    }
+}
+
+/**
+ * @brief                   Checks if a pin is connected to a row that is driven low through the held down buttons
+ *
+ */
+bool
+pulled_low(PinName pin) {
+
+    // with diodes a column is only connected to the rows of its own buttons, without them the connection can go
+    // through any chain of held down buttons
+
+    std::vector<PinName> reached {pin};
+
+    for (size_t i = 0; i < reached.size(); ++i) {
+        for (const auto &k : matrix.pressed) {
+
+            PinName other;
+            if (k.second == reached[i]) {
+                other = k.first;
+            }
+            else if (matrix.diodeless && k.first == reached[i]) {
+                other = k.second;
+            }
+            else {
+                continue;
+            }
+
+            const auto p = pins.find(other);
+            if (p != pins.end() && p->second.output && p->second.value == 0) {
+                return true;
+            }
+
+            if (matrix.diodeless && std::find(reached.begin(), reached.end(), other) == reached.end()) {
+                reached.push_back(other);
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+void
+schedule(const void *owner, uint64_t due, std::function<void()> fn) {
+
+    cancel(owner);
+    timers.push_back({due, timerSeq++, owner, std::move(fn)});
+}
+
+void
+cancel(const void *owner) {
+    timers.erase(std::remove_if(timers.begin(), timers.end(), [owner](const Scheduled &t) { return t.owner == owner; }),
+                 timers.end());
+}
+
+bool
+pending(const void *owner, uint64_t *due) {
+
+    for (const auto &t : timers) {
+        if (t.owner == owner) {
+            *due = t.due;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+advance(std::chrono::microseconds d) {
+
+    // run the timers that fall due in order, each one followed by the edges it raised and the calls it posted
+
+    const auto end = now_us + d.count();
+
+    for (;;) {
+
+        auto it = std::min_element(timers.begin(), timers.end(), [](const Scheduled &a, const Scheduled &b) {
+            return (a.due != b.due) ? a.due < b.due : a.seq < b.seq;
+        });
+
+        if (it == timers.end() || it->due > end) {
+            break;
+        }
+
+        now_us = it->due;
+        const auto fn = std::move(it->fn);
+        timers.erase(it);
+
+        run_isr(fn, isr.timers);
+        process_edges();
+        dispatch_queues();
+    }
+
+    now_us = end;
+    dispatch_queues();
+}
+
+void
+pins_changed() {
+
+    for (auto &p : pins) {
+
+        if (p.second.output) {
+            continue;
+        }
+
+        const int idle = (p.second.pull == PullUp) ? 1 : ((p.second.pull == PullDown) ? 0 : p.second.value);
+        p.second.value = pulled_low(p.first) ? 0 : idle;
+    }
+
+    for (auto *in : interrupts) {
+
+        const int value = pins[in->pin].value;
+        if (value != in->last) {
+
+            in->last = value;
+            if (in->enabled) {
+                pendingEdges.push_back({in, value});
+            }
+        }
+    }
+
+    if (!inIsr) {
+        process_edges();
+    }
+}
+
+PinName
+port_pin(PortName port, int n) {
+    return port * 32 + n;
+}
+
+void
+Matrix::set(PinName row, PinName col, bool down) {
+
+    const auto key = std::make_pair(row, col);
+    const auto it = std::find(pressed.begin(), pressed.end(), key);
+
+    if (down && it == pressed.end()) {
+        pressed.push_back(key);
+    }
+    else if (!down && it != pressed.end()) {
+        pressed.erase(it);
+    }
+
+    pins_changed();
+    dispatch_queues();
+}
+
+uint32_t
+cycles() {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void
+reset_isr_stats() {
+    isr = IsrStats {};
+}
+
+} // namespace sim
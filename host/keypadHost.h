@@ -0,0 +1,73 @@
+/**
+ * @file                    keypadHost.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Simulated matrix and interrupt instrumentation of the host build (see mbed.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADHOST_H__
+#define __KEYPADHOST_H__
+
+#include "mbed.h"
+
+namespace sim {
+
+/**
+ * @brief                   Model of the buttons of a matrix, which connect the pin of a row to the pin of a column
+ *
+ * @remark                  A column reads low if it is connected to a row that is driven low through a held down
+ *                          button, and without diodes, through any chain of held down buttons (which produces ghosts)
+ *
+ */
+struct Matrix {
+
+    /** Held down buttons, as pairs of the pin of the row and the pin of the column */
+    std::vector<std::pair<PinName, PinName>> pressed;
+    /** Whether current can flow through the buttons in both directions (the matrix has no diodes) */
+    bool                diodeless {false};
+
+    /**
+     * @brief               Presses or releases a button, raising the interrupts of the columns that change
+     *
+     * @param row           Pin of the row of the button
+     * @param col           Pin of the column of the button
+     * @param down          Whether the button is held down
+     *
+     */
+    void        set(PinName row, PinName col, bool down);
+};
+
+/**
+ * @brief                   Time spent in the simulated interrupts (measured on the host)
+ *
+ * @remark                  The time includes the cost of the simulated pins, so it is only meaningful as a relative
+ *                          measure between builds of the library on the same host
+ *
+ */
+struct IsrStats {
+
+    /** Number of edge interrupts that ran */
+    uint64_t            edges;
+    /** Number of timer interrupts that ran */
+    uint64_t            timers;
+    /** Total wall-clock time (in nanoseconds) spent in all the interrupts */
+    uint64_t            totalNs;
+};
+
+/** Matrix connected to the pins of the simulation */
+extern Matrix           matrix;
+/** Time spent in the interrupts since the last reset */
+extern IsrStats         isr;
+
+/**
+ * @brief                   Clears the interrupt statistics
+ *
+ */
+void        reset_isr_stats();
+
+} // namespace sim
+
+#endif //__KEYPADHOST_H__
@@ -0,0 +1,107 @@
+/**
+ * @file                    keypadRepeatTest.cpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Checks on the host that a repeating button keeps repeating after it bounces on a release
+ *                          and settles back down, in every per-button mode
+ *
+ * @remark                  Usage: keypad-repeat-test (fails the run if a mode stops repeating after the bounce)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include "keypad.h"
+#include "keypadHost.h"
+
+#include <cstdio>
+
+namespace {
+
+constexpr uint32_t  NumRows     = 4;
+constexpr uint32_t  NumCols     = 4;
+
+const PinName       rowPins[NumRows]    = {0, 1, 2, 3};
+const PinName       colPins[NumCols]    = {10, 11, 12, 13};
+
+/** Number of events of each type received by the callbacks */
+uint32_t            repeats;
+uint32_t            longpresses;
+uint32_t            releases;
+
+/**
+ * @brief                   Long-presses a button, releases it for less than the debounce window, holds it again, and
+ *                          returns the number of repeats received while it is held after the bounce
+ *
+ */
+uint32_t
+repeats_after_bounce(KeypadMode mode) {
+
+    repeats = longpresses = releases = 0;
+
+    sim::now_us = 0;
+    sim::matrix.pressed.clear();
+    sim::pins_changed();
+
+    Keypad<NumRows, NumCols> keypad(rowPins, colPins, mode);
+
+    keypad.set_auto_repeat(std::chrono::milliseconds(400), std::chrono::milliseconds(100));
+    keypad.register_onrepeat([](uint32_t, uint32_t, uint32_t) { ++repeats; });
+    keypad.register_onlongpress([](uint32_t, uint32_t) { ++longpresses; });
+    keypad.register_onrelease([](uint32_t, uint32_t) { ++releases; });
+    keypad.initialize();
+
+    sim::advance(std::chrono::milliseconds(20));
+    sim::matrix.set(rowPins[1], colPins[2], true);
+    sim::advance(std::chrono::milliseconds(600));
+
+    sim::matrix.set(rowPins[1], colPins[2], false);
+    sim::advance(std::chrono::milliseconds(15));
+    sim::matrix.set(rowPins[1], colPins[2], true);
+
+    const auto before = repeats;
+    sim::advance(std::chrono::milliseconds(1000));
+    const auto after = repeats - before;
+
+    sim::matrix.set(rowPins[1], colPins[2], false);
+    sim::advance(std::chrono::milliseconds(200));
+
+    keypad.finalize();
+
+    return (longpresses == 1 && releases == 1) ? after : 0;
+}
+
+} // namespace
+
+int
+main() {
+
+    const struct {
+        const char  *name;
+        KeypadMode  mode;
+    } modes[] = {
+        {"rollover", KeypadMode::ROLLOVER},
+        {"periodic-scan", KeypadMode::PERIODIC_SCAN},
+    };
+
+    bool ok = true;
+
+    for (const auto &m : modes) {
+
+        // the period of 100ms repeats atleast 8 times during the second (the first repeat follows the bounce closely)
+
+        const auto n = repeats_after_bounce(m.mode);
+        printf("%-14s %u repeats after the bounce\n", m.name, n);
+
+        if (n < 8) {
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "\nthe keypad stopped repeating after a button bounced on its release\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file                    keypadSequenceTest.cpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Checks on the host that a tap and a double-tap on the same button are told apart by a
+ *                          KeypadSequence, including a double-tap that fails partway through, in every mode
+ *
+ * @remark                  Usage: keypad-sequence-test (fails the run if a mode reports the wrong sequences)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include "keypad.h"
+#include "keypadHost.h"
+#include "keypadSequence.h"
+
+#include <cstdio>
+
+namespace {
+
+constexpr uint32_t  NumRows     = 4;
+constexpr uint32_t  NumCols     = 4;
+
+const PinName       rowPins[NumRows]    = {0, 1, 2, 3};
+const PinName       colPins[NumCols]    = {10, 11, 12, 13};
+
+constexpr keypad_sequence_step  tap[]       {{KeypadEventType::PRESS, 1, 2}, {KeypadEventType::RELEASE, 1, 2}};
+constexpr keypad_sequence_step  doubleTap[] {{KeypadEventType::PRESS, 1, 2}, {KeypadEventType::RELEASE, 1, 2},
+                                             {KeypadEventType::PRESS, 1, 2, 300}, {KeypadEventType::RELEASE, 1, 2, 300}};
+
+constexpr auto      sequences   = make_keypad_sequences<8>(tap, doubleTap);
+static_assert(!sequences.overflow, "Too many steps for the table!");
+
+/** Number of times each sequence was reported */
+uint32_t            matches[2];
+
+/**
+ * @brief                   Holds the button down for a while, and then releases it for a while
+ *
+ */
+void
+press(uint32_t heldMs, uint32_t releasedMs) {
+
+    sim::matrix.set(rowPins[1], colPins[2], true);
+    sim::advance(std::chrono::milliseconds(heldMs));
+    sim::matrix.set(rowPins[1], colPins[2], false);
+    sim::advance(std::chrono::milliseconds(releasedMs));
+}
+
+/**
+ * @brief                   Runs a pattern of presses on a new keypad, and checks the number of taps and double-taps that
+ *                          are reported
+ *
+ */
+template <typename Pattern>
+bool
+check(KeypadMode mode, const char *name, Pattern pattern, uint32_t taps, uint32_t doubleTaps) {
+
+    matches[0] = matches[1] = 0;
+
+    sim::now_us = 0;
+    sim::matrix.pressed.clear();
+    sim::pins_changed();
+
+    Keypad<NumRows, NumCols> keypad(rowPins, colPins, mode);
+    KeypadSequence recognizer(sequences);
+
+    recognizer.register_onmatch([](uint32_t id) { ++matches[id]; });
+    keypad.set_sequence(&recognizer);
+    keypad.initialize();
+
+    sim::advance(std::chrono::milliseconds(20));
+    pattern();
+    sim::advance(std::chrono::milliseconds(1000));
+
+    keypad.finalize();
+
+    printf("%-24s %u taps, %u double-taps\n", name, matches[0], matches[1]);
+    return matches[0] == taps && matches[1] == doubleTaps;
+}
+
+} // namespace
+
+int
+main() {
+
+    const struct {
+        const char  *name;
+        KeypadMode  mode;
+    } modes[] = {
+        {"single-key", KeypadMode::SINGLE_KEY},
+        {"rollover", KeypadMode::ROLLOVER},
+        {"periodic-scan", KeypadMode::PERIODIC_SCAN},
+    };
+
+    bool ok = true;
+
+    for (const auto &m : modes) {
+
+        printf("%s\n", m.name);
+
+        // the tap is only reported once the window of the second press runs out
+
+        ok &= check(m.mode, "  tap", [] { press(100, 0); }, 1, 0);
+        ok &= check(m.mode, "  double-tap", [] { press(100, 150); press(100, 0); }, 0, 1);
+
+        // the second release misses its window, so both presses are taps (the first one was deferred until the
+        // double-tap failed, and the second one is followed on as the start of a tap)
+
+        ok &= check(m.mode, "  failed double-tap", [] { press(100, 150); press(500, 0); }, 2, 0);
+        ok &= check(m.mode, "  taps too far apart", [] { press(100, 500); press(100, 0); }, 2, 0);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "\nthe recognizer reported the wrong sequences for a tap or a double-tap\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,718 @@
+/**
+ * @file                    mbed.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Host-side stand-in for the parts of the MBed OS API used by the library, which runs the
+ *                          keypad against a simulated matrix in virtual time (see keypadHost.h)
+ *
+ * @remark                  Interrupts and timers run synchronously on the calling thread as virtual time is advanced,
+ *                          and the event queues are dispatched whenever no interrupt is running, so every run is
+ *                          deterministic
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __HOST_MBED_H__
+#define __HOST_MBED_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <new>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// Targets and platform
+
+typedef int PinName;
+typedef int PortName;
+
+enum PinMode {
+    PullNone,
+    PullUp,
+    PullDown
+};
+
+enum osStatus_t {
+    osOK    = 0,
+    osError = -1
+};
+typedef osStatus_t osStatus;
+
+enum osPriority {
+    osPriorityNormal = 24
+};
+
+constexpr PinName   NC                  = -1;
+constexpr uint32_t  osFlagsError        = 0x80000000U;
+constexpr uint32_t  osFlagsErrorTimeout = 0xFFFFFFFEU;
+
+#define DEVICE_PORTIN       1
+#define DEVICE_PORTOUT      1
+#define DEVICE_LPTICKER     1
+
+#define OS_STACK_SIZE       4096
+#define EVENTS_EVENT_SIZE   (sizeof(void *) * 8)
+#define EVENTS_QUEUE_SIZE   (32 * EVENTS_EVENT_SIZE)
+
+#define MBED_ALIGN(n)       alignas(n)
+#define MBED_FORCEINLINE    inline __attribute__((always_inline))
+#define MBED_ASSERT(x)      ((void) 0)
+
+namespace mbed {
+
+template <typename F>
+class Callback;
+
+/**
+ * @brief                   Type-erased callable (backed by std::function on the host)
+ *
+ */
+template <typename R, typename... A>
+class Callback<R(A...)> {
+
+    std::function<R(A...)> fn;
+
+public:
+
+    Callback() = default;
+    Callback(std::nullptr_t) {}
+
+    template <typename F, typename = decltype(std::declval<F>()(std::declval<A>()...))>
+    Callback(F f) : fn(f) {}
+
+    template <typename T, typename M>
+    Callback(T *obj, M method) : fn([obj, method](A... a) { return (obj->*method)(a...); }) {}
+
+    R operator()(A... a) const {
+        return fn(a...);
+    }
+
+    R call(A... a) const {
+        return fn(a...);
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(fn);
+    }
+};
+
+template <typename T, typename R, typename... A>
+Callback<R(A...)> callback(T *obj, R (T::*method)(A...)) {
+    return Callback<R(A...)>(obj, method);
+}
+
+template <typename T, typename R, typename... A>
+Callback<R(A...)> callback(const T *obj, R (T::*method)(A...) const) {
+    return Callback<R(A...)>(obj, method);
+}
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*fn)(A...)) {
+    return Callback<R(A...)>(fn);
+}
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(Callback<R(A...)> cb) {
+    return cb;
+}
+
+/**
+ * @brief                   Stream that bytes can be written to (only the part of the interface used by the library)
+ *
+ */
+class FileHandle {
+
+public:
+
+    virtual ~FileHandle() = default;
+
+    virtual ssize_t write(const void *buffer, size_t size) = 0;
+};
+
+} // namespace mbed
+
+using namespace mbed;
+
+class InterruptIn;
+
+namespace events {
+class EventQueue;
+}
+
+namespace sim {
+
+/** Virtual time (in microseconds) since the start of the simulation */
+extern uint64_t now_us;
+
+/** Level and direction of a simulated pin */
+struct Pin {
+    bool        output {false};
+    int         value {1};
+    PinMode     pull {PullNone};
+};
+
+/** Every pin that was touched by a driver, indexed by name */
+extern std::map<PinName, Pin> pins;
+/** Every interrupt pin that is alive */
+extern std::vector<InterruptIn *> interrupts;
+/** Every event queue that is alive */
+extern std::vector<events::EventQueue *> queues;
+/** Nesting depth of the critical sections */
+extern int critical_depth;
+
+/** Schedules a function to run at a virtual time (replacing any function already scheduled by the owner) */
+void        schedule(const void *owner, uint64_t due, std::function<void()> fn);
+/** Cancels the function scheduled by an owner */
+void        cancel(const void *owner);
+/** Returns whether an owner has a function scheduled (and when it is due) */
+bool        pending(const void *owner, uint64_t *due);
+/** Advances virtual time, running every timer and interrupt that falls due in order */
+void        advance(std::chrono::microseconds d);
+/** Recomputes the level of every input pin and raises the interrupts of the pins that changed */
+void        pins_changed();
+/** Returns the pin at a position within a port */
+PinName     port_pin(PortName port, int n);
+
+} // namespace sim
+
+inline PinName port_pin(PortName port, int n) {
+    return sim::port_pin(port, n);
+}
+
+inline uint32_t us_ticker_read() {
+    return static_cast<uint32_t>(sim::now_us);
+}
+
+/** Frequency of the cycle counter of the host (a nanosecond clock) */
+extern uint32_t SystemCoreClock;
+
+namespace sim {
+
+/** Returns the wall-clock time of the host (in nanoseconds), which stands in for the cycle counter */
+uint32_t    cycles();
+
+} // namespace sim
+
+#define KEYPAD_CYCLE_COUNTER()  (sim::cycles())
+
+namespace Kernel {
+
+struct Clock {
+    using duration      = std::chrono::milliseconds;
+    using rep           = duration::rep;
+    using period        = duration::period;
+    using time_point    = std::chrono::time_point<Clock, duration>;
+    using duration_u32  = std::chrono::duration<uint32_t, std::milli>;
+
+    static constexpr bool is_steady = true;
+
+    static time_point now() {
+        return time_point(duration(sim::now_us / 1000));
+    }
+};
+
+constexpr Clock::duration_u32 wait_for_u32_forever {0xFFFFFFFFU};
+
+} // namespace Kernel
+
+// Drivers
+
+class DigitalOut {
+
+    PinName             pin;
+
+public:
+
+    DigitalOut(PinName p, int value = 0) : pin(p) {
+
+        auto &e = sim::pins[p];
+        e.output = true;
+        e.value = value;
+        sim::pins_changed();
+    }
+
+    void write(int value) {
+        sim::pins[pin].value = value ? 1 : 0;
+        sim::pins_changed();
+    }
+
+    int read() {
+        return sim::pins[pin].value;
+    }
+
+    DigitalOut &operator=(int value) {
+        write(value);
+        return *this;
+    }
+
+    operator int() {
+        return read();
+    }
+};
+
+class InterruptIn {
+
+public:
+
+    PinName             pin;
+    Callback<void()>    fallCb;
+    Callback<void()>    riseCb;
+    bool                enabled {true};
+    int                 last {1};
+
+    InterruptIn(PinName p) : pin(p) {
+
+        last = sim::pins[p].value;
+        sim::interrupts.push_back(this);
+    }
+
+    InterruptIn(PinName p, PinMode m) : InterruptIn(p) {
+        mode(m);
+    }
+
+    ~InterruptIn() {
+        auto &v = sim::interrupts;
+        v.erase(std::remove(v.begin(), v.end(), this), v.end());
+    }
+
+    int read() {
+        return sim::pins[pin].value;
+    }
+
+    operator int() {
+        return read();
+    }
+
+    void mode(PinMode m) {
+        sim::pins[pin].pull = m;
+        sim::pins_changed();
+    }
+
+    void fall(Callback<void()> cb) {
+        fallCb = cb;
+    }
+
+    void rise(Callback<void()> cb) {
+        riseCb = cb;
+    }
+
+    void enable_irq() {
+        enabled = true;
+    }
+
+    void disable_irq() {
+        enabled = false;
+    }
+};
+
+class PortOut {
+
+    PortName            port;
+    int                 mask;
+
+public:
+
+    PortOut(PortName p, int m = static_cast<int>(0xFFFFFFFF)) : port(p), mask(m) {
+
+        for (int i = 0; i < 32; ++i) {
+            if (mask & (1 << i)) {
+                sim::pins[sim::port_pin(port, i)].output = true;
+            }
+        }
+        sim::pins_changed();
+    }
+
+    void write(int value) {
+
+        for (int i = 0; i < 32; ++i) {
+            if (mask & (1 << i)) {
+                sim::pins[sim::port_pin(port, i)].value = (value >> i) & 1;
+            }
+        }
+        sim::pins_changed();
+    }
+
+    int read() {
+
+        int value = 0;
+        for (int i = 0; i < 32; ++i) {
+            if (mask & (1 << i)) {
+                value |= sim::pins[sim::port_pin(port, i)].value << i;
+            }
+        }
+        return value;
+    }
+
+    PortOut &operator=(int value) {
+        write(value);
+        return *this;
+    }
+};
+
+class PortIn {
+
+    PortName            port;
+    int                 mask;
+
+public:
+
+    PortIn(PortName p, int m = static_cast<int>(0xFFFFFFFF)) : port(p), mask(m) {}
+
+    int read() {
+
+        int value = 0;
+        for (int i = 0; i < 32; ++i) {
+            if (mask & (1 << i)) {
+                value |= sim::pins[sim::port_pin(port, i)].value << i;
+            }
+        }
+        return value;
+    }
+
+    void mode(PinMode m) {
+
+        for (int i = 0; i < 32; ++i) {
+            if (mask & (1 << i)) {
+                sim::pins[sim::port_pin(port, i)].pull = m;
+            }
+        }
+        sim::pins_changed();
+    }
+
+    operator int() {
+        return read();
+    }
+};
+
+/**
+ * @brief                   One-shot timer that runs its callback (as an interrupt) once virtual time reaches it
+ *
+ */
+class Timeout {
+
+public:
+
+    ~Timeout() {
+        sim::cancel(this);
+    }
+
+    template <typename D>
+    void attach(Callback<void()> cb, D d) {
+        sim::schedule(this, sim::now_us + std::chrono::duration_cast<std::chrono::microseconds>(d).count(),
+                      [cb]() { cb(); });
+    }
+
+    void detach() {
+        sim::cancel(this);
+    }
+
+    std::chrono::microseconds remaining_time() const {
+
+        uint64_t due;
+        if (!sim::pending(this, &due)) {
+            return 0us;
+        }
+        return std::chrono::microseconds(due - sim::now_us);
+    }
+};
+
+class LowPowerTimeout : public Timeout {};
+
+/**
+ * @brief                   Periodic timer that runs its callback (as an interrupt) every period of virtual time
+ *
+ */
+class Ticker {
+
+    uint64_t            periodUs {0};
+    Callback<void()>    fn;
+
+    void arm() {
+        sim::schedule(this, sim::now_us + periodUs, [this]() { arm(); fn(); });
+    }
+
+public:
+
+    ~Ticker() {
+        sim::cancel(this);
+    }
+
+    template <typename D>
+    void attach(Callback<void()> cb, D d) {
+
+        periodUs = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        fn = cb;
+        arm();
+    }
+
+    void detach() {
+        sim::cancel(this);
+    }
+};
+
+class LowPowerTicker : public Ticker {};
+
+// Events and RTOS
+
+namespace events {
+
+/**
+ * @brief                   Queue of calls, which are run whenever no interrupt is running (instead of on a thread)
+ *
+ */
+class EventQueue {
+
+    struct Call {
+        int                     id;
+        std::function<void()>   fn;
+    };
+
+    std::vector<Call>   calls;
+    int                 nextId {1};
+    size_t              capacity;
+
+public:
+
+    EventQueue(size_t size = EVENTS_QUEUE_SIZE, unsigned char *buffer = nullptr)
+            : capacity(size / EVENTS_EVENT_SIZE)
+    {
+        (void) buffer;
+        sim::queues.push_back(this);
+    }
+
+    ~EventQueue() {
+        auto &v = sim::queues;
+        v.erase(std::remove(v.begin(), v.end(), this), v.end());
+    }
+
+    template <typename F>
+    int call(F f) {
+
+        if (calls.size() >= capacity) {
+            return 0;
+        }
+
+        calls.push_back({nextId, std::function<void()>(f)});
+        return nextId++;
+    }
+
+    template <typename T, typename R>
+    int call(T *obj, R (T::*method)()) {
+        return call([obj, method]() { (obj->*method)(); });
+    }
+
+    bool cancel(int id) {
+
+        auto it = std::find_if(calls.begin(), calls.end(), [id](const Call &e) { return e.id == id; });
+        if (it == calls.end()) {
+            return false;
+        }
+
+        calls.erase(it);
+        return true;
+    }
+
+    /** Runs every pending call (including the ones posted while running them) */
+    void dispatch_once() {
+
+        while (!calls.empty()) {
+
+            auto e = std::move(calls.front());
+            calls.erase(calls.begin());
+            e.fn();
+        }
+    }
+
+    void dispatch_forever() {}
+    void break_dispatch() {}
+};
+
+} // namespace events
+
+using events::EventQueue;
+
+inline EventQueue *mbed_event_queue() {
+    static EventQueue queue;
+    return &queue;
+}
+
+namespace rtos {
+
+/**
+ * @brief                   Thread that never runs (the event queues are dispatched by the simulation instead)
+ *
+ */
+class Thread {
+
+    bool                started {false};
+
+public:
+
+    Thread(osPriority priority = osPriorityNormal, uint32_t stackSize = OS_STACK_SIZE,
+           unsigned char *stackMem = nullptr, const char *name = nullptr)
+    {
+        (void) priority;
+        (void) stackSize;
+        (void) stackMem;
+        (void) name;
+    }
+
+    osStatus start(Callback<void()> task) {
+
+        (void) task;
+        if (started) {
+            return osError;
+        }
+
+        started = true;
+        return osOK;
+    }
+
+    osStatus join() {
+        return osOK;
+    }
+};
+
+/**
+ * @brief                   Event flags, where waiting advances virtual time until a flag is set (or the timeout elapses)
+ *
+ */
+class EventFlags {
+
+    uint32_t            flags {0};
+
+public:
+
+    uint32_t set(uint32_t f) {
+        flags |= f;
+        return flags;
+    }
+
+    uint32_t clear(uint32_t f = 0x7FFFFFFF) {
+
+        const uint32_t old = flags;
+        flags &= ~f;
+        return old;
+    }
+
+    uint32_t get() const {
+        return flags;
+    }
+
+    uint32_t wait_any_for(uint32_t f, Kernel::Clock::duration_u32 rel, bool clear = true) {
+
+        // waiting forever is bounded, so that a missing event fails the run instead of hanging it
+
+        if (rel == Kernel::wait_for_u32_forever) {
+            rel = Kernel::Clock::duration_u32(10000000);
+        }
+
+        const auto deadline = Kernel::Clock::now() + rel;
+        while (!(flags & f)) {
+
+            if (Kernel::Clock::now() >= deadline) {
+                return osFlagsErrorTimeout;
+            }
+            sim::advance(1ms);
+        }
+
+        const uint32_t old = flags;
+        if (clear) {
+            flags &= ~f;
+        }
+        return old;
+    }
+};
+
+namespace ThisThread {
+
+inline void sleep_for(std::chrono::milliseconds d) {
+    sim::advance(d);
+}
+
+} // namespace ThisThread
+
+} // namespace rtos
+
+using namespace rtos;
+
+// Critical sections and atomics (interrupts never preempt each other on the host)
+
+inline void core_util_critical_section_enter() {
+    ++sim::critical_depth;
+}
+
+inline void core_util_critical_section_exit() {
+    --sim::critical_depth;
+}
+
+class CriticalSectionLock {
+
+public:
+
+    CriticalSectionLock() {
+        core_util_critical_section_enter();
+    }
+
+    ~CriticalSectionLock() {
+        core_util_critical_section_exit();
+    }
+};
+
+inline bool core_util_atomic_load_bool(const volatile bool *p) {
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+inline void core_util_atomic_store_bool(volatile bool *p, bool v) {
+    __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+}
+
+inline bool core_util_atomic_exchange_bool(volatile bool *p, bool v) {
+    return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+
+#define HOST_ATOMIC(T, S)                                                                                              \
+    inline T core_util_atomic_load_##S(const volatile T *p) {                                                         \
+        return __atomic_load_n(p, __ATOMIC_SEQ_CST);                                                                   \
+    }                                                                                                                  \
+    inline void core_util_atomic_store_##S(volatile T *p, T v) {                                                      \
+        __atomic_store_n(p, v, __ATOMIC_SEQ_CST);                                                                      \
+    }                                                                                                                  \
+    inline T core_util_atomic_exchange_##S(volatile T *p, T v) {                                                      \
+        return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);                                                            \
+    }                                                                                                                  \
+    inline T core_util_atomic_incr_##S(volatile T *p, T d) {                                                          \
+        return __atomic_add_fetch(p, d, __ATOMIC_SEQ_CST);                                                             \
+    }                                                                                                                  \
+    inline T core_util_atomic_decr_##S(volatile T *p, T d) {                                                          \
+        return __atomic_sub_fetch(p, d, __ATOMIC_SEQ_CST);                                                             \
+    }                                                                                                                  \
+    inline T core_util_atomic_fetch_add_##S(volatile T *p, T d) {                                                     \
+        return __atomic_fetch_add(p, d, __ATOMIC_SEQ_CST);                                                             \
+    }                                                                                                                  \
+    inline T core_util_atomic_fetch_or_##S(volatile T *p, T d) {                                                      \
+        return __atomic_fetch_or(p, d, __ATOMIC_SEQ_CST);                                                              \
+    }                                                                                                                  \
+    inline T core_util_atomic_fetch_and_##S(volatile T *p, T d) {                                                     \
+        return __atomic_fetch_and(p, d, __ATOMIC_SEQ_CST);                                                             \
+    }                                                                                                                  \
+    inline bool core_util_atomic_cas_##S(volatile T *p, T *e, T d) {                                                  \
+        return __atomic_compare_exchange_n(p, e, d, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);                        \
+    }
+
+HOST_ATOMIC(uint8_t, u8)
+HOST_ATOMIC(uint16_t, u16)
+HOST_ATOMIC(uint32_t, u32)
+HOST_ATOMIC(uint64_t, u64)
+
+#undef HOST_ATOMIC
+
+#endif //__HOST_MBED_H__
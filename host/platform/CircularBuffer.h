@@ -0,0 +1,12 @@
+/**
+ * @file                    CircularBuffer.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Host-side stand-in for platform/CircularBuffer.h (the library includes it, but does not use
+ *                          it anymore)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include "mbed.h"
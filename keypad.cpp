@@ -1,272 +1,664 @@
 #include "keypad.h"
+#include "keypadRecord.h"
+#include "keypadSequence.h"
 
-/** Duration of time a button spends bouncing before stabilizing */
-constexpr auto DEBOUNCE_THRESH = 60ms;
-
-/** Duration of time a button must be pressed to be considered long-pressed */
-constexpr auto LONG_PRESS_THRESH = 300ms;
-
-// Constructors
-
-Keypad::Keypad(PinName r0, PinName r1, PinName r2, PinName r3, PinName c0, PinName c1, PinName c2, PinName c3)
-        : row{{r0}, {r1}, {r2}, {r3}}
-        , col{{c0}, {c1}, {c2}, {c3}}
-{
-    // Use the internal pullup resistors for all the interrupt pins (cols) and switch the rows off
-    // whenever a button is pressed, its corresponding column is pulled low, i.e. a fall interrupt happens
-    // whenever a button is lifted, its corresponding column is pulled high, i.e. a rise interrupt happens
-    // register fall and rise handlers for each of the interrupt pins (cols)
-
-    for (auto &e : col) {
-        e.mode(PullUp);
-    }
-
-    for (auto &e : row) {
-        e = 0;
-    }
-
-    static_assert(KEYPAD_NUM_COLS == 4, "Constructor does not initialize all columns!");
-
-    col[0].fall(callback(this, &Keypad::fall_handler<0>));
-    col[1].fall(callback(this, &Keypad::fall_handler<1>));
-    col[2].fall(callback(this, &Keypad::fall_handler<2>));
-    col[3].fall(callback(this, &Keypad::fall_handler<3>));
-
-    col[0].rise(callback(this, &Keypad::rise_handler<0>));
-    col[1].rise(callback(this, &Keypad::rise_handler<1>));
-    col[2].rise(callback(this, &Keypad::rise_handler<2>));
-    col[3].rise(callback(this, &Keypad::rise_handler<3>));
-}
+/** Number of events pulled out of the ring at a time while draining it (the whole ring, so that a batch callback
+    receives every pending event at once) */
+constexpr uint32_t DRAIN_BATCH_LEN = KEYPAD_EVENT_RING_LEN;
 
 // Public Methods
 
 bool
-Keypad::initialize() {
+KeypadBase::initialize() {
 
-    // return if the thread was already initialized; move forward otherwise
-    // allocate the thread and return if the allocation fails; move forward otherwise
-    // try to start the thread and return if successful
-    // in case of failure, delete the allocated thread and return
+    // return if the object was already initialized; move forward otherwise
+    // if a queue was supplied by the user, start posting on it and return
+    // allocate the thread together with its queue and return if the allocation fails; move forward otherwise
+    // try to start the thread, start posting on the queue and return if successful
+    // in case of failure, delete the allocated thread and queue and return
 
     if (is_initialized()) {
         return false;
     }
 
-    threadHandle = new (std::nothrow) Thread();
-    if (threadHandle == nullptr) {
+    if (sharedQueue != nullptr) {
+
+        queue = sharedQueue;
+        post_drain();
+
+        return true;
+    }
+
+    ownDispatch = new (std::nothrow) OwnDispatch();
+    if (ownDispatch == nullptr) {
         return false;
     }
 
-    auto status = threadHandle->start(callback(this, &Keypad::dispatch_events));
+    queue = &ownDispatch->queue;
+    auto status = ownDispatch->thread.start(callback(&ownDispatch->queue, &EventQueue::dispatch_forever));
 
     if (status != osOK) {
 
-        delete threadHandle;
-        threadHandle = nullptr;
+        queue = nullptr;
+
+        delete ownDispatch;
+        ownDispatch = nullptr;
 
         return false;
     }
 
+    // events generated before the object was initialized are still in the ring
+
+    post_drain();
     return true;
 }
 
 bool
-Keypad::finalize() {
+KeypadBase::finalize() {
 
-    // return if the thread was not initialized; move forward otherwise
-    // break the queues dispatch and use shouldTerminate to wait until the action is complete
-    // terminate the thread and return if that fails
-    // free the thread and return
+    // return if the object was not initialized; move forward otherwise
+    // stop posting on the queue (no ISR can be halfway through posting once the critical section is entered)
+    // if the queue was supplied by the user, cancel the pending call to drain the ring (if it was not dispatched yet)
+    // otherwise break the queues dispatch, wait for the thread to terminate and free the thread and the queue
+    // the events that were not drained remain in the ring until the object is initialized again
 
     if (!is_initialized()) {
         return false;
     }
 
-    queue.break_dispatch();
-    threadHandle->join();
+    EventQueue *oldQueue;
+    int oldDrainId;
+    {
+        CriticalSectionLock lock;
+
+        oldQueue = queue;
+        oldDrainId = drainId;
+
+        queue = nullptr;
+        drainId = 0;
+    }
 
-    delete threadHandle;
-    threadHandle = nullptr;
+    if (ownDispatch == nullptr) {
+
+        if (oldDrainId != 0) {
+            oldQueue->cancel(oldDrainId);
+        }
+    }
+    else {
+
+        oldQueue->break_dispatch();
+        ownDispatch->thread.join();
+
+        delete ownDispatch;
+        ownDispatch = nullptr;
+    }
+
+    core_util_atomic_store_bool(&drainPending, false);
     return true;
 }
 
 bool
-Keypad::is_initialized() const {
+KeypadBase::is_initialized() const {
 
-    // if threadHandle is NULL, then the object was not initialized/finalized before
+    // if queue is NULL, then the object was not initialized/finalized before
     // otherwise it is still in the initialized state
 
-    return threadHandle != nullptr;
+    return queue != nullptr;
+}
+
+bool
+KeypadBase::register_onpress(Callback<void(uint32_t, uint32_t)> cb) {
+    return onPress.attach(std::move(cb));
 }
 
 void
-Keypad::register_onpress(Callback<void(uint32_t, uint32_t)> cb) {
+KeypadBase::remove_onpress() {
+    onPress.detach();
+}
 
-    onPress = std::move(cb);
-    pressCbEnabled = true;
+bool
+KeypadBase::is_onpress_registered() const {
+    return onPress.is_attached();
+}
+
+bool
+KeypadBase::register_onrelease(Callback<void(uint32_t, uint32_t)> cb) {
+    return onRelease.attach(std::move(cb));
 }
 
 void
-Keypad::remove_onpress() {
-    pressCbEnabled = false;
+KeypadBase::remove_onrelease() {
+    onRelease.detach();
+}
+
+bool
+KeypadBase::is_onrelease_registered() const {
+    return onRelease.is_attached();
 }
 
 bool
-Keypad::is_onpress_registered() const {
-    return pressCbEnabled;
+KeypadBase::register_onlongpress(Callback<void(uint32_t, uint32_t)> cb) {
+    return onLongpress.attach(std::move(cb));
 }
 
 void
-Keypad::register_onrelease(Callback<void(uint32_t, uint32_t)> cb) {
+KeypadBase::remove_onlongpress() {
+    onLongpress.detach();
+}
 
-    onRelease = std::move(cb);
-    releaseCbEnabled = true;
+bool
+KeypadBase::is_onlongpress_registered() const {
+    return onLongpress.is_attached();
+}
+
+bool
+KeypadBase::register_oncancel(Callback<void(uint32_t, uint32_t)> cb) {
+    return onCancel.attach(std::move(cb));
 }
 
 void
-Keypad::remove_onrelease() {
-    releaseCbEnabled = false;
+KeypadBase::remove_oncancel() {
+    onCancel.detach();
+}
+
+bool
+KeypadBase::is_oncancel_registered() const {
+    return onCancel.is_attached();
 }
 
 bool
-Keypad::is_onrelease_registered() const {
-    return releaseCbEnabled;
+KeypadBase::register_onrepeat(Callback<void(uint32_t, uint32_t, uint32_t)> cb) {
+    return onRepeat.attach(std::move(cb));
 }
 
 void
-Keypad::register_onlongpress(Callback<void(uint32_t, uint32_t)> cb) {
+KeypadBase::remove_onrepeat() {
+    onRepeat.detach();
+}
+
+bool
+KeypadBase::is_onrepeat_registered() const {
+    return onRepeat.is_attached();
+}
 
-    onLongpress = std::move(cb);
-    longpressCbEnabled = true;
+bool
+KeypadBase::register_onevent(Callback<void(keypad_event)> cb) {
+    return onEvent.attach(std::move(cb));
 }
 
 void
-Keypad::remove_onlongpress() {
-    longpressCbEnabled = false;
+KeypadBase::remove_onevent() {
+    onEvent.detach();
 }
 
 bool
-Keypad::is_onlongpress_registered() const {
-    return longpressCbEnabled;
+KeypadBase::is_onevent_registered() const {
+    return onEvent.is_attached();
 }
 
-// Private Methods
+bool
+KeypadBase::register_onbatch(Callback<void(const keypad_event *, size_t)> cb) {
+    return onBatch.attach(std::move(cb));
+}
 
-template<uint32_t curCol>
 void
-Keypad::fall_handler() {
+KeypadBase::remove_onbatch() {
+    onBatch.detach();
+}
 
-    if (state != ButtonState::RELEASED) {
-        return;
+bool
+KeypadBase::is_onbatch_registered() const {
+    return onBatch.is_attached();
+}
+
+bool
+KeypadBase::register_onimmediate(Callback<void(keypad_event)> cb) {
+    return onImmediate.attach(std::move(cb));
+}
+
+void
+KeypadBase::remove_onimmediate() {
+    onImmediate.detach();
+}
+
+bool
+KeypadBase::is_onimmediate_registered() const {
+    return onImmediate.is_attached();
+}
+
+uint32_t
+KeypadBase::get_dropped_events() const {
+    return core_util_atomic_load_u32(&counters.dropped);
+}
+
+void
+KeypadBase::get_counters(keypad_counters *countersPtr) const {
+
+    countersPtr->delivered = core_util_atomic_load_u32(&counters.delivered);
+    countersPtr->dropped = core_util_atomic_load_u32(&counters.dropped);
+    countersPtr->postFailures = core_util_atomic_load_u32(&counters.postFailures);
+    countersPtr->overwritten = core_util_atomic_load_u32(&counters.overwritten);
+    countersPtr->bouncesRejected = core_util_atomic_load_u32(&counters.bouncesRejected);
+    countersPtr->concurrentRejected = core_util_atomic_load_u32(&counters.concurrentRejected);
+    countersPtr->ghostsSuppressed = core_util_atomic_load_u32(&counters.ghostsSuppressed);
+    countersPtr->filtered = core_util_atomic_load_u32(&counters.filtered);
+}
+
+void
+KeypadBase::reset_counters() {
+
+    core_util_atomic_store_u32(&counters.delivered, 0);
+    core_util_atomic_store_u32(&counters.dropped, 0);
+    core_util_atomic_store_u32(&counters.postFailures, 0);
+    core_util_atomic_store_u32(&counters.overwritten, 0);
+    core_util_atomic_store_u32(&counters.bouncesRejected, 0);
+    core_util_atomic_store_u32(&counters.concurrentRejected, 0);
+    core_util_atomic_store_u32(&counters.ghostsSuppressed, 0);
+    core_util_atomic_store_u32(&counters.filtered, 0);
+}
+
+void
+KeypadBase::set_recorder(KeypadRecorder *log) {
+
+    if (log != nullptr) {
+        log->start();
     }
+    recorder = log;
+}
 
-    //transition_state(ButtonState::RELEASED, ButtonState::PRESS_BOUNCING);
-    state = ButtonState::PRESS_BOUNCING;
-    toRowScan.attach(callback(this, &Keypad::row_scan_handler<curCol>), DEBOUNCE_THRESH);
+KeypadRecorder *
+KeypadBase::get_recorder() const {
+    return recorder;
 }
 
-template<uint32_t curCol>
 void
-Keypad::rise_handler() {
+KeypadBase::set_sequence(KeypadSequence *recognizer) {
 
-    if (state != ButtonState::PRESSED && state != ButtonState::LONG_PRESSED) {
-        return;
+    KeypadSequence *prev = sequence;
+    if (prev != nullptr) {
+
+        prev->reset();
+        prev->owner = nullptr;
     }
 
-    //transition_state(ButtonState::PRESSED, ButtonState::RELEASE_BOUNCING)
-    //|| transition_state(ButtonState::LONG_PRESSED, ButtonState::RELEASE_BOUNCING);
-    state = ButtonState::RELEASE_BOUNCING;
-    toButtonScan.attach(callback(this, &Keypad::button_scan_handler), DEBOUNCE_THRESH);
+    if (recognizer != nullptr) {
+
+        recognizer->reset();
+        recognizer->owner = this;
+    }
+
+    sequence = recognizer;
+}
+
+KeypadSequence *
+KeypadBase::get_sequence() const {
+    return sequence;
+}
+
+#if defined(KEYPAD_LATENCY_STATS)
+void
+KeypadBase::get_latency_stats(keypad_latency_stats *edgeToConfirmPtr, keypad_latency_stats *confirmToCallbackPtr) const {
+
+    CriticalSectionLock lock;
+
+    *edgeToConfirmPtr = edgeToConfirm;
+    *confirmToCallbackPtr = confirmToCallback;
+}
+
+void
+KeypadBase::reset_latency_stats() {
+
+    CriticalSectionLock lock;
+
+    edgeToConfirm = {};
+    confirmToCallback = {};
 }
+#endif
 
-template<uint32_t curCol>
+#if defined(KEYPAD_ISR_STATS)
 void
-Keypad::row_scan_handler() {
+KeypadBase::get_isr_stats(keypad_isr_stats (*statsPtr)[KEYPAD_ISR_COUNT]) const {
 
-    if (state != ButtonState::PRESS_BOUNCING) {
+    CriticalSectionLock lock;
+
+    for (uint32_t i = 0; i < KEYPAD_ISR_COUNT; ++i) {
+        (*statsPtr)[i] = isrStats[i];
+    }
+}
+
+void
+KeypadBase::reset_isr_stats() {
+
+    CriticalSectionLock lock;
+
+    for (auto &s : isrStats) {
+        s = {};
+    }
+}
+#endif
+
+// Protected Methods
+
+KeypadBase::KeypadBase(EventQueue &userQueue)
+        : sharedQueue(&userQueue)
+{
+}
+
+void
+KeypadBase::post_event(KeypadEventType type, uint32_t r, uint32_t c, bool first) {
+
+    // discard the event if its button is filtered out of its type (only the log still records it), or if nobody is
+    // listening for it
+    // call the immediate callback right away (this is already ISR context)
+    // push the event into the ring (or the priority ring) if there is space, count it as dropped otherwise
+    // make sure that a call to drain the ring is pending
+
+    KeypadRecorder *log = recorder;
+    if (log != nullptr) {
+        log->record(KeypadRecordKind::EVENT, type, r, c);
+    }
+
+    const auto bit = 1U << c;
+
+    if (keyMasks != nullptr && (keyMasks[static_cast<uint32_t>(type) * maskRows + r] & bit) != 0) {
+
+        core_util_atomic_incr_u32(&counters.filtered, 1);
         return;
     }
 
-    for (uint32_t i = 0; i < KEYPAD_NUM_ROWS; ++i) {
+    KeypadSequence *recognizer = sequence;
+    const bool queued = onEvent.is_attached() || onBatch.is_attached() || is_event_registered(type) ||
+                        (recognizer != nullptr && recognizer->uses(type));
 
-        row[i] = 1;
-        auto on = col[curCol].read();
-        row[i] = 0;
+    if (!queued && !onImmediate.is_attached()) {
+        return;
+    }
 
-        if (!on) {
-            continue;
-        }
+    keypad_event e {};
+    e.type = static_cast<uint32_t>(type);
+    e.r = r;
+    e.c = c;
+    e.first = first;
+    e.time = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
 
-        //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::PRESSED);
-        state = ButtonState::PRESSED;
-        pressedRow = i;
-        pressedCol = curCol;
+#if defined(KEYPAD_LATENCY_STATS)
+    const uint32_t nowUs = us_ticker_read();
 
-        toLongPressed.attach(callback(this, &Keypad::long_press_handler), LONG_PRESS_THRESH);
+    if (type == KeypadEventType::PRESS && edgePending) {
+        keypad_latency_record(edgeToConfirm, nowUs - edgeUs);
+        edgePending = false;
+    }
+#endif
 
-        if (pressCbEnabled) {
-            queue.call([this, i]() { onPress(i, curCol); });
-        }
+    onImmediate.call(e);
 
+    if (!queued) {
         return;
     }
 
-    //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::RELEASED);
-    state = ButtonState::RELEASED;
+#if defined(KEYPAD_LATENCY_STATS)
+    const RingEntry entry {e, nowUs};
+#else
+    const RingEntry &entry = e;
+#endif
+
+    // events may be generated by the edge ISRs as well as the timer ISRs (which may preempt each other), so the pushes
+    // are serialized to keep the ring single-producer
+
+    const bool urgent = keyMasks != nullptr && (keyMasks[KEYPAD_NUM_EVENT_TYPES * maskRows + r] & bit) != 0;
+
+    bool pushed;
+    {
+        CriticalSectionLock lock;
+        pushed = urgent ? priorityRing.push(entry) : ring.push(entry);
+    }
+
+    if (!pushed) {
+        core_util_atomic_incr_u32(&counters.dropped, 1);
+    }
+
+    post_drain();
 }
 
 void
-Keypad::button_scan_handler() {
+KeypadBase::count_bounce() {
+    core_util_atomic_incr_u32(&counters.bouncesRejected, 1);
+}
 
-    if (state != RELEASE_BOUNCING) {
-        return;
-    }
+void
+KeypadBase::attach_key_masks(const volatile uint32_t *masks, uint32_t numRows) {
+
+    keyMasks = masks;
+    maskRows = numRows;
+}
 
-    auto curRow = pressedRow;
-    auto curCol = pressedCol;
+void
+KeypadBase::record(KeypadRecordKind kind, uint32_t r, uint32_t c) {
 
-    if (!col[pressedCol].read()) {
+    // a log that is flushed to a file is drained on the dispatch thread once it is half full, even if no events are
+    // generated in the meantime (such as while a button is bouncing)
 
-        //transition_state(ButtonState::RELEASE_BOUNCING, ButtonState::PRESSED);
-        state = ButtonState::PRESSED;
+    KeypadRecorder *log = recorder;
+    if (log == nullptr) {
         return;
     }
 
-    //transition_state(ButtonState::RELEASE_BOUNCING, ButtonState::RELEASED);
-    state = ButtonState::RELEASED;
-    if (toLongPressed.remaining_time().count() > 0) {
-        toLongPressed.detach();
+    if (log->record(kind, KeypadEventType::PRESS, r, c) && log->has_sink() && log->size() >= log->capacity() / 2) {
+        post_drain();
     }
+}
 
-    if (releaseCbEnabled) {
-        queue.call(
-            [this, curRow, curCol]() {
-                onRelease(curRow, curCol);
-            }
-        );
+void
+KeypadBase::count_concurrent() {
+    core_util_atomic_incr_u32(&counters.concurrentRejected, 1);
+}
+
+void
+KeypadBase::count_ghost() {
+    core_util_atomic_incr_u32(&counters.ghostsSuppressed, 1);
+}
+
+#if defined(KEYPAD_LATENCY_STATS)
+void
+KeypadBase::mark_edge() {
+
+    // the handlers only call this on the edge that starts debouncing (or scanning), so a rejected edge is simply
+    // overwritten by the next one
+
+    edgeUs = us_ticker_read();
+    edgePending = true;
+}
+#endif
+
+#if defined(KEYPAD_ISR_STATS)
+void
+KeypadBase::record_isr(KeypadIsr isr, uint32_t cycles) {
+
+    // the edge and timer interrupts may preempt each other, and the cycles of the handler were already counted, so the
+    // critical section is not accounted to it
+
+    CriticalSectionLock lock;
+
+    auto &s = isrStats[static_cast<uint32_t>(isr)];
+
+    if (cycles > s.max) {
+        s.max = cycles;
     }
+
+    ++s.count;
+    s.total += cycles;
 }
+#endif
+
+// Private Methods
 
 void
-Keypad::long_press_handler() {
+KeypadBase::post_drain() {
+
+    // if a call to drain the ring is not already pending, post one
+    // if the object is not initialized or posting fails, the next event (or initialization) retries
 
-    if (state != ButtonState::PRESSED) {
+    if (core_util_atomic_exchange_bool(&drainPending, true)) {
         return;
     }
 
-    auto curRow = pressedRow;
-    auto curCol = pressedCol;
+    EventQueue *curQueue = queue;
+    const int id = (curQueue != nullptr) ? curQueue->call(this, &KeypadBase::drain_events) : 0;
 
-    //transition_state(ButtonState::PRESSED, ButtonState::LONG_PRESSED);
-    state = ButtonState::LONG_PRESSED;
+    if (id == 0) {
 
-    if (longpressCbEnabled) {
-        queue.call([this, curRow, curCol]() { onLongpress(curRow, curCol); });
+        // a failure is only counted if there was a queue to post on (the events just wait for initialization otherwise)
+
+        if (curQueue != nullptr) {
+            core_util_atomic_incr_u32(&counters.postFailures, 1);
+        }
+
+        core_util_atomic_store_bool(&drainPending, false);
+        return;
+    }
+
+    drainId = id;
+}
+
+void
+KeypadBase::drain_events() {
+
+    // clear the flag before draining, so that events pushed after this point post a new call
+    // (events pushed before this point are drained by this call)
+
+    core_util_atomic_store_bool(&drainPending, false);
+
+    // the priority ring is checked before every batch, so that the events of priority buttons generated while a batch
+    // is being dispatched are dispatched before the rest of the ring
+
+    RingEntry batch[DRAIN_BATCH_LEN];
+    uint32_t n;
+
+    while ((n = priorityRing.pop(batch, DRAIN_BATCH_LEN)) != 0 || (n = ring.pop(batch, DRAIN_BATCH_LEN)) != 0) {
+
+        core_util_atomic_incr_u32(&counters.delivered, n);
+
+#if defined(KEYPAD_LATENCY_STATS)
+        keypad_event events[DRAIN_BATCH_LEN];
+
+        for (uint32_t i = 0; i < n; ++i) {
+            {
+                CriticalSectionLock lock;
+                keypad_latency_record(confirmToCallback, us_ticker_read() - batch[i].confirmedUs);
+            }
+
+            events[i] = batch[i].e;
+        }
+#else
+        const keypad_event *events = batch;
+#endif
+
+        // the batch callback sees the whole batch before the per-event callbacks are called for it
+
+        onBatch.call(events, n);
+
+        for (uint32_t i = 0; i < n; ++i) {
+            dispatch_event(events[i]);
+        }
+    }
+
+    // the recognizer is polled even if no events were drained, since its timer drains the ring to report its expiry
+
+    KeypadSequence *recognizer = sequence;
+    if (recognizer != nullptr) {
+        recognizer->poll();
+    }
+
+    KeypadRecorder *log = recorder;
+    if (log != nullptr) {
+        log->flush();
+    }
+}
+
+bool
+KeypadBase::is_event_registered(KeypadEventType type) const {
+
+    switch (type) {
+
+    case KeypadEventType::PRESS:
+        return onPress.is_attached();
+
+    case KeypadEventType::RELEASE:
+        return onRelease.is_attached();
+
+    case KeypadEventType::LONGPRESS:
+        return onLongpress.is_attached();
+
+    case KeypadEventType::CANCEL:
+        return onCancel.is_attached();
+
+    case KeypadEventType::REPEAT:
+        return onRepeat.is_attached();
     }
+
+    return false;
 }
 
 void
-Keypad::dispatch_events() {
+KeypadBase::dispatch_event(const keypad_event &e) {
+
+    // the callback may have been removed after the event was pushed, so check again before calling it
+    // the repeats are counted here instead of being carried by the events (only one button repeats at a time, and the
+    // first repeat of every hold is marked)
+    // the count also starts over once the hold ends (a press stops the repeats of any button, a release or cancel only
+    // those of its own), so that a hold whose first repeat was dropped or filtered out does not continue the count of
+    // the previous one
+
+    switch (keypad_event_type(e)) {
+
+    case KeypadEventType::REPEAT:
+        repeatCount = (e.first || e.r != repeatRow || e.c != repeatCol) ? 1 : repeatCount + 1;
+        repeatRow = e.r;
+        repeatCol = e.c;
+        break;
+
+    case KeypadEventType::PRESS:
+        repeatCount = 0;
+        break;
+
+    case KeypadEventType::RELEASE:
+    case KeypadEventType::CANCEL:
+        if (e.r == repeatRow && e.c == repeatCol) {
+            repeatCount = 0;
+        }
+        break;
+
+    case KeypadEventType::LONGPRESS:
+        break;
+    }
+
+    onEvent.call(e);
+
+    switch (keypad_event_type(e)) {
+
+    case KeypadEventType::PRESS:
+        onPress.call(e.r, e.c);
+        break;
 
-    queue.dispatch_forever();
+    case KeypadEventType::RELEASE:
+        onRelease.call(e.r, e.c);
+        break;
+
+    case KeypadEventType::LONGPRESS:
+        onLongpress.call(e.r, e.c);
+        break;
+
+    case KeypadEventType::CANCEL:
+        onCancel.call(e.r, e.c);
+        break;
+
+    case KeypadEventType::REPEAT:
+        onRepeat.call(e.r, e.c, repeatCount);
+        break;
+    }
+
+    KeypadSequence *recognizer = sequence;
+    if (recognizer != nullptr) {
+        recognizer->feed(e);
+    }
 }
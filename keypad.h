@@ -2,7 +2,7 @@
  * @file                    Keypad.h
  * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
  *
- * @brief                   Simple Library to use a 4x4 Keypad with MBed OS asynchronously
+ * @brief                   Simple Library to use a matrix Keypad with MBed OS asynchronously
  *
  * @copyright               Copyright (c) 2023
  *
@@ -15,104 +15,181 @@
 #include "mbed.h"
 #include "platform/CircularBuffer.h"
 
-/** Maximum number of presses/releases/long-presses to queue up before overwriting */
+#include "keypadCallback.h"
+#include "keypadDispatcher.h"
+#include "keypadEvents.h"
+#include "keypadIO.h"
+#include "keypadKeymap.h"
+#include "keypadRecord.h"
+#include "keypadStats.h"
+
+#include <utility>
+
+/** Default maximum number of events (of all types) a KeypadBlocking object queues up before overwriting */
 constexpr auto      KEYPAD_BUFFER_LEN   = 16;
-/** Number of rows on a keypad */
-constexpr auto      KEYPAD_NUM_ROWS     = 4;
-/** Number of columns on a keypad */
-constexpr auto      KEYPAD_NUM_COLS     = 4;
+/** Maximum number of events to hold between the ISRs and the dispatch thread before dropping (must be a power of 2) */
+constexpr uint32_t  KEYPAD_EVENT_RING_LEN = 32;
+/** Maximum number of events of priority buttons to hold before dropping (must be a power of 2) */
+constexpr uint32_t  KEYPAD_PRIORITY_RING_LEN = 8;
+/** Default number of rows on a keypad (used when the geometry is not specified) */
+constexpr uint32_t  KEYPAD_NUM_ROWS     = 4;
+/** Default number of columns on a keypad (used when the geometry is not specified) */
+constexpr uint32_t  KEYPAD_NUM_COLS     = 4;
 
 /**
- * @brief                   Class that provides a simple interface to use a 4x4 keypad asynchronously
+ * @brief                   Enumeration of the engines that a keypad can use to track its buttons
  *
- * @remark                  At a time, only a single button on the keypad can be pressed, pressing multiple buttons
- *                          at the same time will only cause the earliest to be accepted, while all others are rejected
  */
-class Keypad {
+enum class KeypadMode {
 
+    /** Only a single button is tracked at a time, any presses while a button is held down are rejected */
+    SINGLE_KEY,
+    /** Every button is tracked on its own (N-key rollover), the matrix is scanned while any button is held down */
+    ROLLOVER,
+    /** Every button is tracked on its own (N-key rollover), the matrix is scanned by a free-running ticker and the
+        column interrupts are not used, which bounds the time spent in interrupts irrespective of the input */
+    PERIODIC_SCAN,
+    /** Every button is tracked on its own (N-key rollover), the matrix is scanned by the application (such as by a DMA,
+        see KeypadScanCapture) and each scan is passed to Keypad::process_scan(), the keypad uses no interrupts or
+        timers at all */
+    EXTERNAL_SCAN
+};
 
-    /**
-     * @brief               Enumeration consisting of all the possible states of the keypad state machine
-     *
-     * @todo                Add link to state machine diagram in README
-     */
-    enum ButtonState {
+#if defined(KEYPAD_LOW_POWER) && DEVICE_LPTICKER
+/** Ticker used to scan the matrix in the KeypadMode::PERIODIC_SCAN mode (KEYPAD_LOW_POWER is defined) */
+using KeypadScanTicker = LowPowerTicker;
+/** Timeout used for the debounce, long-press and scan timers (KEYPAD_LOW_POWER is defined, does not lock deep sleep) */
+using KeypadTimeout = LowPowerTimeout;
+#else
+/** Ticker used to scan the matrix in the KeypadMode::PERIODIC_SCAN mode */
+using KeypadScanTicker = Ticker;
+/** Timeout used for the debounce, long-press and scan timers (locks deep sleep while pending) */
+using KeypadTimeout = Timeout;
+#endif
 
-        RELEASED,
-        PRESS_BOUNCING,
-        PRESSED,
-        RELEASE_BOUNCING,
-        LONG_PRESSED
+class KeypadSequence;
+
+/**
+ * @brief                   Geometry-independent part of the Keypad, which owns the dispatch thread, the event queue
+ *                          and the registered callbacks
+ *
+ * @remark                  This class can not be instantiated directly, the Keypad class template must be used instead
+ */
+class KeypadBase {
+
+    friend class KeypadSequence;
+
+    /** Thread and Event Queue of an object that owns its queue, allocated together */
+    struct OwnDispatch {
+
+        /** Thread used to execute callback functions */
+        Thread          thread;
+        /** Buffer of the queue, which only ever holds the call to drain the ring */
+        unsigned char   buffer[keypad_dispatch_queue_size(1)];
+        /** Event Queue dispatched by the thread */
+        EventQueue      queue {sizeof buffer, buffer};
     };
 
-    /** Pins connected to the Keypad's rows */
-    DigitalOut          row[KEYPAD_NUM_ROWS];
-    /** Pins connected to the Keypad's cols */
-    InterruptIn         col[KEYPAD_NUM_COLS];
+    /** Thread and Event Queue used to execute callback functions (only allocated if no queue was supplied by the
+        user, while the object is initialized) */
+    OwnDispatch         *ownDispatch {nullptr};
+    /** User-supplied Event Queue to dispatch callbacks on (nullptr if the object uses its own) */
+    EventQueue          *const sharedQueue {nullptr};
+    /** Event Queue on which the callback functions are called (nullptr while not initialized) */
+    EventQueue          *volatile queue {nullptr};
+    /** Identifier of the most recent call to drain the ring posted on the queue */
+    volatile int        drainId {0};
 
-    /** Thread used to execute callback functions */
-    Thread              *threadHandle {nullptr};
+#if defined(KEYPAD_LATENCY_STATS)
+    /** Entry of the ring, which carries the time at which the event was confirmed (KEYPAD_LATENCY_STATS is defined) */
+    struct RingEntry {
+        keypad_event    e;
+        uint32_t        confirmedUs;
+    };
+#else
+    /** Entry of the ring */
+    using RingEntry = keypad_event;
+#endif
 
-    /** Event Queue on which calls to the callback functions will be posted */
-    EventQueue          queue;
+    /** Events generated in ISR context that are yet to be dispatched */
+    KeypadEventRing<KEYPAD_EVENT_RING_LEN, RingEntry> ring;
+    /** Events of priority buttons that are yet to be dispatched (always drained before the other events) */
+    KeypadEventRing<KEYPAD_PRIORITY_RING_LEN, RingEntry> priorityRing;
+    /** Whether a call to drain the ring is already pending on the event queue */
+    volatile bool       drainPending {false};
+    /** Counters of the events that were delivered, delayed or lost (updated atomically) */
+    keypad_counters     counters {};
 
-    /** Whether the Callback on a button press is registered or not */
-    bool                pressCbEnabled {false};
     /** Callback function that is called when a button is pressed */
-    Callback<void(uint32_t, uint32_t)> onPress;
+    KeypadCallback<void(uint32_t, uint32_t)> onPress;
 
-    /** Whether the Callback on a button release is registered or not */
-    bool                releaseCbEnabled {false};
     /** Callback function that is called when a button is released */
-    Callback<void(uint32_t, uint32_t)> onRelease;
+    KeypadCallback<void(uint32_t, uint32_t)> onRelease;
 
-    /** Whether the Callback on a button being long-pressed is registered or not */
-    bool                longpressCbEnabled {false};
     /** Callback function that is called when a button is long-pressed */
-    Callback<void(uint32_t, uint32_t)> onLongpress;
+    KeypadCallback<void(uint32_t, uint32_t)> onLongpress;
 
-    /** State of the button in the state machine */
-    ButtonState         state {ButtonState::RELEASED};
+    /** Callback function that is called when an eagerly reported press is cancelled */
+    KeypadCallback<void(uint32_t, uint32_t)> onCancel;
 
-    /** Timeout to indicate when to switch from PRESS_BOUNCING (button bouncing after being pressed) to PRESSED/RELEASED */
-    Timeout             toRowScan;
-    /** Timeout to indicate when to switch from PRESSED/LONG_PRESSED to RELEASE_BOUNCING (button bouncing after being released) */
-    Timeout             toButtonScan;
-    /** Timeout to indicate when to switch from PRESSED to LONG_PRESSED */
-    Timeout             toLongPressed;
+    /** Callback function that is called when a button is auto-repeated */
+    KeypadCallback<void(uint32_t, uint32_t, uint32_t)> onRepeat;
+    /** Number of auto-repeats of the button currently being held down (only used by the dispatch thread) */
+    uint32_t            repeatCount {0};
+    /** Row of the button that was repeated latest (only used by the dispatch thread) */
+    uint32_t            repeatRow {0};
+    /** Column of the button that was repeated latest (only used by the dispatch thread) */
+    uint32_t            repeatCol {0};
 
-    /** Confirmed Row on which the button was pressed (after row-scanning) */
-    uint32_t            pressedRow {};
-    /** Confirmed Column on which the button was pressed (after row-scanning) */
-    uint32_t            pressedCol {};
+    /** Callback function that is called on every event */
+    KeypadCallback<void(keypad_event)> onEvent;
 
-public:
+    /** Callback function that is called once with all the events that were pending when the ring was drained */
+    KeypadCallback<void(const keypad_event *, size_t)> onBatch;
 
-    Keypad() = delete;
+    /** Callback function that is called immediately (in ISR context) on every event */
+    KeypadCallback<void(keypad_event)> onImmediate;
 
-    /**
-     * @brief               Construct a new keypad object
-     *
-     * @param r0            Microcontroller Pin to which Row Pin 0 of the keypad is connected
-     * @param r1            Microcontroller Pin to which Row Pin 1 of the keypad is connected
-     * @param r2            Microcontroller Pin to which Row Pin 2 of the keypad is connected
-     * @param r3            Microcontroller Pin to which Row Pin 3 of the keypad is connected
-     * @param c0            Microcontroller Pin to which Column Pin 0 of the keypad is connected
-     * @param c1            Microcontroller Pin to which Column Pin 1 of the keypad is connected
-     * @param c2            Microcontroller Pin to which Column Pin 2 of the keypad is connected
-     * @param c3            Microcontroller Pin to which Column Pin 3 of the keypad is connected
-     *
-     */
-    Keypad(PinName r0, PinName r1, PinName r2, PinName r3, PinName c0, PinName c1, PinName c2, PinName c3);
+    /** Bitmasks of the buttons filtered out of each type of event, followed by the bitmasks of the priority buttons
+        (one bitmask per row of each, in the storage of the Keypad, nullptr if every event is queued in order) */
+    const volatile uint32_t *keyMasks {nullptr};
+    /** Number of rows of each set of bitmasks */
+    uint32_t            maskRows {0};
+
+    /** Log to which the raw input and the events are recorded (nullptr if nothing is recorded) */
+    KeypadRecorder      *volatile recorder {nullptr};
+    /** Recognizer that is fed the events on the dispatch thread (nullptr if there is none) */
+    KeypadSequence      *volatile sequence {nullptr};
+
+#if defined(KEYPAD_LATENCY_STATS)
+    /** Time (in microseconds) of the column edge that started debouncing (or scanning) the buttons */
+    uint32_t            edgeUs {0};
+    /** Whether an edge is waiting to be confirmed as a press */
+    bool                edgePending {false};
+
+    /** Latency from the first column edge to the press being confirmed */
+    keypad_latency_stats edgeToConfirm {};
+    /** Latency from an event being confirmed to its callbacks being called */
+    keypad_latency_stats confirmToCallback {};
+#endif
+
+#if defined(KEYPAD_ISR_STATS)
+    /** Cycles spent in each interrupt handler, indexed by KeypadIsr */
+    keypad_isr_stats    isrStats[KEYPAD_ISR_COUNT] {};
+#endif
+
+public:
 
     /**
      * @brief               Initializes the object by allocating and starting a thread to dispatch callbacks on
      *
      * @remark              If the thread was already initialized, then the Keypad::finalize() method must be called
      *                      before trying to re-initialize
+     * @remark              If the object was constructed on a user-supplied queue, then no thread or queue is allocated,
+     *                      and callbacks are dispatched by whichever thread dispatches that queue (otherwise the thread
+     *                      and a queue that only holds the call to drain the ring are allocated together)
      *
      * @attention           Can not call this method from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      * @return              true if the thread was successfully allocated and started, false otherwise
      *
@@ -124,12 +201,13 @@ public:
      *
      * @remark              If the thread was not initialized or finalized before, then the Keypad::initialize()
      *                      method must be called before trying to re-finalize it
+     * @remark              If the object was constructed on a user-supplied queue, then the pending call to dispatch
+     *                      the callbacks is cancelled (a call that the queue has already started still completes)
      * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
      *                      methods are called, they must be explicitly disabled by calling their respective remove
      *                      methods
      *
      * @attention           Can not call this method from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      * @return              true if the thread was successfully stopped and freed, false otherwise
      *
@@ -153,21 +231,23 @@ public:
     /**
      * @brief               Register a callback function to be called whenever a button is pressed
      *
-     * @remark              If a callback was already registered, then the current one replaces it
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
      * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
      *                      methods are called, they must be explicitly disabled by calling their respective remove
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
-     *
      *
      * @param cb            Callback when a button is pressed
      *                      , the first argument to the callback is the row which the pressed button belongs to
      *                      , the second argument to the callback is the column which the pressed button belongs to
      *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
      */
-    void        register_onpress(Callback<void(uint32_t, uint32_t)> cb);
+    bool        register_onpress(Callback<void(uint32_t, uint32_t)> cb);
 
     /**
      * @brief               Remove the previously registered callback function for when a button is pressed
@@ -178,7 +258,6 @@ public:
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      */
     void        remove_onpress();
@@ -198,20 +277,23 @@ public:
     /**
      * @brief               Register a callback function to be called whenever a button is released
      *
-     * @remark              If a callback was already registered, then the current one replaces it
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
      * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
      *                      methods are called, they must be explicitly disabled by calling their respective remove
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      * @param cb            Callback when a button is released
      *                      , the first argument to the callback is the row which the released button belongs to
      *                      , the second argument to the callback is the column which the released button belongs to
      *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
      */
-    void        register_onrelease(Callback<void(uint32_t, uint32_t)> cb);
+    bool        register_onrelease(Callback<void(uint32_t, uint32_t)> cb);
 
     /**
      * @brief               Remove the previously registered callback function for when a button is released
@@ -222,7 +304,6 @@ public:
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      */
     void        remove_onrelease();
@@ -242,20 +323,23 @@ public:
     /**
      * @brief               Register a callback function to be called whenever a button is long-pressed
      *
-     * @remark              If a callback was already registered, then the current one replaces it
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
      * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
      *                      methods are called, they must be explicitly disabled by calling their respective remove
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      * @param cb            Callback when a button is long-pressed
      *                      , the first argument to the callback is the row which the long-pressed button belongs to
      *                      , the second argument to the callback is the column which the long-pressed button belongs to
      *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
      */
-    void        register_onlongpress(Callback<void(uint32_t, uint32_t)> cb);
+    bool        register_onlongpress(Callback<void(uint32_t, uint32_t)> cb);
 
     /**
      * @brief               Remove the previously registered callback function for when a button was long-pressed
@@ -266,7 +350,6 @@ public:
      *                      methods
      *
      * @attention           This function can be called from ISR context
-     * @attention           It is unsafe to call this method from multiple threads concurrently
      *
      */
     void        remove_onlongpress();
@@ -287,55 +370,1417 @@ public:
      */
     bool        is_onlongpress_registered() const;
 
-private:
+    /**
+     * @brief               Register a callback function to be called whenever an eagerly reported press is cancelled
+     *
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
+     * @remark              Only generated while eager press reporting is enabled (see Keypad::set_eager_press())
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback when a press is cancelled
+     *                      , the first argument to the callback is the row which the cancelled press belongs to
+     *                      , the second argument to the callback is the column which the cancelled press belongs to
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
+     */
+    bool        register_oncancel(Callback<void(uint32_t, uint32_t)> cb);
 
     /**
-     * @brief               Handler for when a fall interrupt is received on a column pin
+     * @brief               Remove the previously registered callback function for when a press was cancelled
      *
-     * @tparam curCol       The column of the keypad that this handler should cater to
+     * @remark              Has no effect if no callback was registered
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
      *
      */
-    template <uint32_t curCol>
-    void        fall_handler ();
+    void        remove_oncancel();
 
     /**
-     * @brief               Handler for a when a rise interrupt is received on a column pin
+     * @brief               Checks if a callback function is registered for when a press is cancelled
      *
-     * @tparam curCol       The column of the keypad that this handler should cater to
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @return              true if a callback is currently registered, false otherwise
      *
      */
-    template <uint32_t curCol>
-    void        rise_handler ();
+    bool        is_oncancel_registered() const;
 
     /**
-     * @brief               Scans the rows after a button press on a column was detected to determine its row
+     * @brief               Register a callback function to be called whenever a held down button is auto-repeated
      *
-     * @tparam curCol       The column of the keypad that this handler should cater to
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
+     * @remark              Only generated while auto-repeat is enabled (see Keypad::set_auto_repeat())
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback when a button is auto-repeated
+     *                      , the first argument to the callback is the row which the repeated button belongs to
+     *                      , the second argument to the callback is the column which the repeated button belongs to
+     *                      , the third argument to the callback is the number of repeats since the button was pressed
+     *                      (starting from 1)
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
      *
      */
-    template <uint32_t curCol>
-    void        row_scan_handler ();
+    bool        register_onrepeat(Callback<void(uint32_t, uint32_t, uint32_t)> cb);
 
     /**
-     * @brief               Scans the previously pressed button after a button release was detected to confirm
+     * @brief               Remove the previously registered callback function for when a button was auto-repeated
+     *
+     * @remark              Has no effect if no callback was registered
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
      *
      */
-    void        button_scan_handler ();
+    void        remove_onrepeat();
 
     /**
-     * @brief               Transitions a button to the long-pressed state onec it has been held down
-     *                      past the threshold duration
+     * @brief               Checks if a callback function is registered for when a button is auto-repeated
+     *
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @return              true if a callback is currently registered, false otherwise
      *
      */
-    void        long_press_handler ();
+    bool        is_onrepeat_registered() const;
+
+    /**
+     * @brief               Register a callback function to be called on every event (press, release or long-press)
+     *
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
+     * @remark              The callback is called in addition to the callback registered for the type of the event
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback on every event
+     *                      , the only argument to the callback is the event (with its type, coordinates and timestamp)
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
+     */
+    bool        register_onevent(Callback<void(keypad_event)> cb);
 
     /**
-     * @brief           Function for queue to run callbacks on
+     * @brief               Remove the previously registered callback function for every event
+     *
+     * @remark              Has no effect if no callback was registered
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
      *
-     * @remark          Calling break_dispatch() on the queue will cause the thread to wait for graceful termination
+     * @attention           This function can be called from ISR context
      *
      */
-    void        dispatch_events ();
-};
+    void        remove_onevent();
+
+    /**
+     * @brief               Checks if a callback function is registered for every event
+     *
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @return              true if a callback is currently registered, false otherwise
+     *
+     */
+    bool        is_onevent_registered() const;
+
+    /**
+     * @brief               Register a callback function to be called once with every batch of events that are delivered
+     *                      together
+     *
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
+     * @remark              All the events that are pending when the dispatch thread drains them (upto
+     *                      KEYPAD_EVENT_RING_LEN) are passed in a single call, in the order they were generated, so
+     *                      bursts of events do not cost a call each
+     * @remark              The callback is called before the callbacks registered for the types of the events in the
+     *                      batch (which are still called)
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     * @attention           The events are only valid for the duration of the call
+     *
+     * @param cb            Callback on every batch of events
+     *                      , the first argument to the callback is the location of the earliest event in the batch
+     *                      , the second argument to the callback is the number of events in the batch (atleast 1)
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
+     */
+    bool        register_onbatch(Callback<void(const keypad_event *, size_t)> cb);
+
+    /**
+     * @brief               Remove the previously registered callback function for every batch of events
+     *
+     * @remark              Has no effect if no callback was registered
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        remove_onbatch();
+
+    /**
+     * @brief               Checks if a callback function is registered for every batch of events
+     *
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @return              true if a callback is currently registered, false otherwise
+     *
+     */
+    bool        is_onbatch_registered() const;
+
+    /**
+     * @brief               Register a callback function to be called immediately (in ISR context) on every event
+     *
+     * @remark              If a callback was already registered, then the current one replaces it, which is safe even
+     *                      while the keypad is running and the previous one is being called (see KeypadCallback)
+     * @remark              The callback is called directly by the handler that generates the event, before the event
+     *                      is passed to the dispatch thread, which avoids the latency and jitter of a context switch
+     * @remark              The callbacks registered for the dispatch thread are still called as usual
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           The callback runs in ISR context, so it must be short and must not block, allocate or call
+     *                      any API that is not ISR-safe (such as printf() or a Mutex)
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback on every event
+     *                      , the only argument to the callback is the event (with its type, coordinates and timestamp)
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
+     */
+    bool        register_onimmediate(Callback<void(keypad_event)> cb);
+
+    /**
+     * @brief               Remove the previously registered callback function that is called immediately on every event
+     *
+     * @remark              Has no effect if no callback was registered
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        remove_onimmediate();
+
+    /**
+     * @brief               Checks if a callback function is registered to be called immediately on every event
+     *
+     * @remark              Any registered callbacks are preserved when the Keypad::initialize() and Keypad::finalize()
+     *                      methods are called, they must be explicitly disabled by calling their respective remove
+     *                      methods
+     *
+     * @return              true if a callback is currently registered, false otherwise
+     *
+     */
+    bool        is_onimmediate_registered() const;
+
+    /**
+     * @brief               Returns the number of events that were dropped (since construction) because they were
+     *                      generated faster than the dispatch thread could consume them
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of dropped events
+     *
+     */
+    uint32_t    get_dropped_events() const;
+
+    /**
+     * @brief               Returns a snapshot of the counters of the events that were delivered, delayed or lost
+     *
+     * @remark              Each counter is read atomically, but the counters are not read together, so events that are
+     *                      generated while taking the snapshot may only be reflected in some of them
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param countersPtr   Location where the snapshot should be stored
+     *
+     */
+    void        get_counters(keypad_counters *countersPtr) const;
+
+    /**
+     * @brief               Clears all the counters (including the number of dropped events)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        reset_counters();
+
+#if defined(KEYPAD_LATENCY_STATS)
+    /**
+     * @brief               Returns the latency distributions measured so far (only if KEYPAD_LATENCY_STATS is defined)
+     *
+     * @remark              The edge to confirm latency is measured from the first column edge to the press being
+     *                      confirmed after debouncing, and is not measured in the KeypadMode::PERIODIC_SCAN mode (which
+     *                      does not use the column interrupts)
+     * @remark              The confirm to callback latency is measured from an event being confirmed (in ISR context)
+     *                      to its callbacks being called on the dispatch thread
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param edgeToConfirm     Location where the edge to confirm distribution should be stored
+     * @param confirmToCallback Location where the confirm to callback distribution should be stored
+     *
+     */
+    void        get_latency_stats(keypad_latency_stats *edgeToConfirm, keypad_latency_stats *confirmToCallback) const;
+
+    /**
+     * @brief               Clears the latency distributions measured so far (only if KEYPAD_LATENCY_STATS is defined)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        reset_latency_stats();
+#endif
+
+    /**
+     * @brief               Starts (or stops) recording the raw input and the events of the keypad to a log
+     *
+     * @remark              The column edges (in the edge driven modes), the buttons that changed in each scan (in the
+     *                      per-button modes) and every event (whether a callback is registered for it or not) are
+     *                      recorded
+     * @remark              If the log has a file set (see KeypadRecorder::set_sink()), it is flushed on the dispatch
+     *                      thread every time the events are dispatched, and whenever it is half full
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param log           Log to record to (must outlive the object or be detached first), nullptr to stop recording
+     *
+     */
+    void        set_recorder(KeypadRecorder *log);
+
+    /**
+     * @brief               Returns the log to which the keypad is recording
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Log set through Keypad::set_recorder(), nullptr if the keypad is not recording
+     *
+     */
+    KeypadRecorder *get_recorder() const;
+
+    /**
+     * @brief               Attaches (or detaches) a recognizer of sequences of events (see KeypadSequence)
+     *
+     * @remark              The events of the types used by the sequences are queued even if no callback is registered
+     *                      for them, and the recognizer is fed every event after its callbacks are called
+     *
+     * @attention           A recognizer must only be attached to a single keypad at a time, and must not be attached or
+     *                      detached while the events are being dispatched
+     *
+     * @param recognizer    Recognizer to attach (must outlive the object or be detached first), nullptr to detach it
+     *
+     */
+    void        set_sequence(KeypadSequence *recognizer);
+
+    /**
+     * @brief               Returns the recognizer of sequences attached to the keypad
+     *
+     * @return              Recognizer set through Keypad::set_sequence(), nullptr if there is none
+     *
+     */
+    KeypadSequence *get_sequence() const;
+
+#if defined(KEYPAD_ISR_STATS)
+    /**
+     * @brief               Returns the cycles spent in each interrupt handler so far (only if KEYPAD_ISR_STATS is
+     *                      defined)
+     *
+     * @remark              The cycles are counted from the entry to the exit of each handler, including the immediate
+     *                      callback (which runs inside the handlers), and are converted to microseconds using
+     *                      keypad_cycles_to_us()
+     * @remark              On cores without a DWT cycle counter, the counts only have a resolution of a microsecond
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param statsPtr      Location where the statistics of every handler should be stored, indexed by KeypadIsr
+     *
+     */
+    void        get_isr_stats(keypad_isr_stats (*statsPtr)[KEYPAD_ISR_COUNT]) const;
+
+    /**
+     * @brief               Clears the cycles spent in each interrupt handler so far (only if KEYPAD_ISR_STATS is defined)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        reset_isr_stats();
+#endif
+
+protected:
+
+#if defined(KEYPAD_ISR_STATS)
+    /**
+     * @brief               Scope that accounts the cycles from its construction to its destruction to a handler (only if
+     *                      KEYPAD_ISR_STATS is defined)
+     *
+     * @remark              Must be constructed first thing in a handler, so that every return is accounted
+     *
+     */
+    class IsrProfile {
+
+        KeypadBase      &keypad;
+        const KeypadIsr isr;
+        const uint32_t  start;
+
+    public:
+
+        IsrProfile(KeypadBase &owner, KeypadIsr handler) : keypad(owner), isr(handler), start(keypad_cycles()) {}
+        ~IsrProfile() { keypad.record_isr(isr, keypad_cycles() - start); }
+    };
+#endif
+
+    KeypadBase() = default;
+
+    /**
+     * @brief               Construct a new object that dispatches its callbacks on a user-supplied queue
+     *
+     * @param userQueue     Event Queue to dispatch callbacks on (must outlive the object)
+     *
+     */
+    explicit KeypadBase(EventQueue &userQueue);
+
+    /**
+     * @brief               Adds an event to the ring and makes sure that a call to drain it is pending on the queue
+     *
+     * @remark              The immediate callback (if registered) is called before the event is added to the ring
+     * @remark              Events whose callbacks are not registered are discarded right away
+     * @remark              No allocation is done per event, atmost one call per object is pending on the queue
+     *
+     * @attention           This function can be called from ISR context
+     * @attention           This function can be called from multiple ISRs (the producer side of the ring is serialized
+     *                      with a critical section)
+     *
+     * @param type          Type of the event
+     * @param r             Row of the button
+     * @param c             Column of the button
+     * @param first         Whether the event is the first KeypadEventType::REPEAT event of the button being held down
+     *
+     */
+    void        post_event(KeypadEventType type, uint32_t r, uint32_t c, bool first = false);
+
+    /**
+     * @brief               Sets the bitmasks of the buttons that are filtered out of each type of event, and of the
+     *                      priority buttons
+     *
+     * @remark              Called once by the constructor of the Keypad (before any event is generated)
+     *
+     * @param masks         KEYPAD_NUM_EVENT_TYPES + 1 sets of numRows bitmasks (bit c of the bitmask of row r is set to
+     *                      filter out, or prioritize, the button on row r and column c), the sets of the types come
+     *                      first, in order of their value, and the set of the priority buttons comes last
+     * @param numRows       Number of rows of the keypad
+     *
+     */
+    void        attach_key_masks(const volatile uint32_t *masks, uint32_t numRows);
+
+    /**
+     * @brief               Records raw input to the log (does nothing if the keypad is not recording)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param kind          Kind of the record (not KeypadRecordKind::EVENT, events are recorded by post_event())
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     */
+    void        record(KeypadRecordKind kind, uint32_t r, uint32_t c);
+
+    /**
+     * @brief               Counts a press or release that was rejected while debouncing
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        count_bounce();
+
+    /**
+     * @brief               Counts a press that was rejected because another button was held down
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        count_concurrent();
+
+    /**
+     * @brief               Counts an ambiguous combination of buttons that started being suppressed
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        count_ghost();
+
+#if defined(KEYPAD_LATENCY_STATS)
+    /**
+     * @brief               Records the time of a column edge that may lead to a press (only if KEYPAD_LATENCY_STATS is
+     *                      defined)
+     *
+     * @remark              Must only be called on the edge that starts debouncing (or scanning) the buttons
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        mark_edge();
+#endif
+
+#if defined(KEYPAD_ISR_STATS)
+    /**
+     * @brief               Accounts a run of an interrupt handler (only if KEYPAD_ISR_STATS is defined)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param isr           Handler that ran
+     * @param cycles        Cycles spent in the handler
+     *
+     */
+    void        record_isr(KeypadIsr isr, uint32_t cycles);
+#endif
+
+private:
+
+    /**
+     * @brief               Posts a call to drain the ring on the queue, unless one is already pending
+     *
+     * @remark              Nothing is posted while the object is not initialized (the events stay in the ring)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        post_drain ();
+
+    /**
+     * @brief               Removes all events from the ring in batches and calls their respective callbacks
+     *
+     * @remark              Runs on the event queue
+     *
+     */
+    void        drain_events ();
+
+    /**
+     * @brief               Checks if a callback is registered for a type of event
+     *
+     * @param type          Type of the event
+     *
+     * @return              true if a callback is registered for the type of event, false otherwise
+     *
+     */
+    bool        is_event_registered (KeypadEventType type) const;
+
+    /**
+     * @brief               Calls the registered callback of an event
+     *
+     * @param e             Event to dispatch
+     *
+     */
+    void        dispatch_event (const keypad_event &e);
+};
+
+template <uint32_t NumRows>
+class KeypadGroup;
+
+/**
+ * @brief                   Class that provides a simple interface to use a matrix keypad asynchronously
+ *
+ * @remark                  In the KeypadMode::SINGLE_KEY mode, only a single button on the keypad can be pressed at a
+ *                          time, pressing multiple buttons at the same time will only cause the earliest to be accepted,
+ *                          while all others are rejected
+ * @remark                  In the KeypadMode::ROLLOVER and KeypadMode::PERIODIC_SCAN modes, each button has its own
+ *                          state and generates its own events, irrespective of how many other buttons are held down
+ * @remark                  The geometry is fixed at compile time, so each instantiation only contains the pins, handlers
+ *                          and state needed for its own number of rows and columns
+ *
+ * @remark                  The pins are accessed through a backend (IO), which is either KeypadPinIO (each pin on its
+ *                          own) or KeypadPortIO (all rows and all columns through one port each)
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ * @tparam IO               Backend used to drive the rows and read the columns (see keypadIO.h)
+ */
+template <uint32_t NumRows = KEYPAD_NUM_ROWS, uint32_t NumCols = KEYPAD_NUM_COLS,
+          template <uint32_t, uint32_t> class IO = KeypadPinIO>
+class Keypad : public KeypadBase {
+
+    static_assert(NumRows > 0, "Keypad must have atleast one row!");
+    static_assert(NumRows <= 32, "Keypad can not have more than 32 rows!");
+    static_assert(NumCols > 0, "Keypad must have atleast one column!");
+    static_assert(NumCols <= 32, "Keypad can not have more than 32 columns!");
+
+    /**
+     * @brief               Enumeration consisting of all the possible states of the keypad state machine
+     *
+     * @todo                Add link to state machine diagram in README
+     */
+    enum ButtonState {
+
+        RELEASED,
+        PRESS_BOUNCING,
+        PRESSED,
+        RELEASE_BOUNCING,
+        LONG_PRESSED,
+        LONG_RELEASE_BOUNCING
+    };
+
+    /** Total number of buttons on the keypad */
+    static constexpr uint32_t NumKeys = NumRows * NumCols;
+    /** Bitmask with the bits of all the rows set */
+    static constexpr uint32_t AllRows = (NumRows == 32) ? ~0U : ((1U << NumRows) - 1);
+    /** Bitmask with the bits of all the columns set */
+    static constexpr uint32_t AllCols = (NumCols == 32) ? ~0U : ((1U << NumCols) - 1);
+
+    /** Backend that owns the pins connected to the Keypad's rows and cols */
+    IO<NumRows, NumCols> io;
+
+    /** Engine used to track the buttons */
+    const KeypadMode    mode;
+
+    /** State of the button in the state machine */
+    ButtonState         state {ButtonState::RELEASED};
+
+    /** State of each button in the per-button modes, packed as nibbles (two buttons per byte, indexed by row * NumCols + col) */
+    uint8_t             keyStates[(NumKeys + 1) / 2] {};
+    /** Number of consecutive scans each button has spent in its current state in the per-button modes */
+    uint8_t             keyTicks[NumKeys] {};
+    /** Bitmask of the long-pressed buttons of each row in the per-button modes (a scan only needs to step the buttons
+        whose level differs from it, or that are timed) */
+    uint32_t            heldKeys[NumRows] {};
+    /** Bitmask of the buttons of each row whose state is timed by counting scans in the per-button modes (bouncing,
+        pressed but not long-pressed yet, or auto-repeating), which are stepped on every scan */
+    uint32_t            timedKeys[NumRows] {};
+    /** Number of buttons that are not in the RELEASED state in the per-button modes */
+    uint32_t            activeKeys {0};
+    /** Bitmask of the buttons of each row that are currently held down, as reported by the events (set by a press,
+        cleared by a release or a cancel) */
+    uint32_t            downKeys[NumRows] {};
+    /** Whether the matrix is currently being scanned periodically in rollover mode */
+    bool                scanning {false};
+    /** Latest scan of the matrix in the per-button modes (see Keypad::scan_matrix()) */
+    uint32_t            lastFrame[NumRows] {};
+    /** Whether the matrix has diodes on its buttons, which makes every combination unambiguous (no ghost detection) */
+    bool                diodes {false};
+
+    /** Bitmasks of the buttons of each row that are filtered out of each type of event, followed by the bitmasks of the
+        priority buttons of each row (read by KeypadBase::post_event()) */
+    volatile uint32_t   keyFilters[(KEYPAD_NUM_EVENT_TYPES + 1) * NumRows] {};
+    /** Whether an ambiguous combination of buttons was being suppressed in the latest scan */
+    bool                ghosting {false};
+
+    /** Timeout to indicate when to switch from PRESS_BOUNCING (button bouncing after being pressed) to PRESSED/RELEASED
+        (also used to schedule the next matrix scan in rollover mode) */
+    KeypadTimeout       toRowScan;
+    /** Timeout to indicate when to switch from PRESSED/LONG_PRESSED to RELEASE_BOUNCING (button bouncing after being released) */
+    KeypadTimeout       toButtonScan;
+    /** Timeout to indicate when to switch from PRESSED to LONG_PRESSED */
+    KeypadTimeout       toLongPressed;
+
+    /** Ticker that scans the matrix in periodic-scan mode */
+    KeypadScanTicker    scanTicker;
+
+    /** Whether presses are reported on the first edge and verified after the debounce window (only in
+        KeypadMode::SINGLE_KEY) */
+    bool                eager {false};
+
+    /** Debounce window (in milliseconds) of every button while adaptive debouncing is disabled */
+    uint8_t             debounceMs {};
+    /** Number of consecutive scans for which a button must be stable in the per-button modes to finish bouncing */
+    uint8_t             debounceScans {};
+    /** Whether the debounce window of each button is learned from its bounces (only in KeypadMode::SINGLE_KEY) */
+    bool                adaptive {false};
+    /** Smallest debounce window (in milliseconds) that adaptive debouncing may use */
+    uint8_t             adaptiveMinMs {};
+    /** Largest debounce window (in milliseconds) that adaptive debouncing may use */
+    uint8_t             adaptiveMaxMs {};
+    /** Learned debounce window (in milliseconds) of each button while adaptive debouncing is enabled (0 until the
+        bounces of the button are observed) */
+    uint8_t             keyDebounceMs[NumKeys] {};
+    /** Time (in microseconds) of the edge that started the current bouncing period (only used while adaptive) */
+    uint32_t            bounceStartUs {};
+    /** Time (in microseconds) of the latest edge during the current bouncing period (only used while adaptive) */
+    uint32_t            bounceLastUs {};
+    /** Time (in microseconds) at which the latest bouncing period was confirmed (only used while adaptive) */
+    uint32_t            lastConfirmUs {};
+    /** Index of the button whose bouncing period was confirmed latest (only used while adaptive) */
+    uint32_t            lastBounceKey {};
+
+    /** Whether a held down button generates repeats after being long-pressed */
+    bool                repeat {false};
+    /** Time (in milliseconds) from a press being reported to its first repeat */
+    uint16_t            repeatDelayMs {};
+    /** Time (in milliseconds) between the first two repeats */
+    uint16_t            repeatPeriodMs {};
+    /** Shortest time (in milliseconds) between two repeats that the period accelerates to */
+    uint16_t            repeatMinMs {};
+    /** Time (in milliseconds) between the latest two repeats of the button currently repeating */
+    uint16_t            repeatCurMs {};
+    /** Time (in milliseconds) to wait until the next repeat of the button currently repeating */
+    uint16_t            repeatWaitMs {};
+    /** Number of scans since the latest repeat (or long-press) in the per-button modes */
+    uint16_t            repeatTicks {};
+    /** Whether the next repeat is the first one of the button being held down */
+    bool                repeatFirst {false};
+    /** Button that was pressed latest in the per-button modes (NumKeys if it was released) */
+    uint32_t            latestKey {NumKeys};
+    /** Button that is currently repeating in the per-button modes (NumKeys if none) */
+    uint32_t            repeatKey {NumKeys};
+
+    /** Confirmed Row on which the button was pressed (after row-scanning) */
+    uint32_t            pressedRow {};
+    /** Confirmed Column on which the button was pressed (after row-scanning) */
+    uint32_t            pressedCol {};
+
+public:
+
+    Keypad() = delete;
+
+    /**
+     * @brief               Construct a new keypad object
+     *
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param engine        Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    Keypad(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+           KeypadMode engine = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new keypad object whose rows and columns are accessed through GPIO ports
+     *
+     * @remark              Can only be used with a port-mapped backend (such as KeypadPortIO)
+     *
+     * @attention           Every row pin must belong to rowPort and every column pin must belong to colPort
+     *
+     * @param rowPort       GPIO port to which all the Row Pins of the keypad belong
+     * @param colPort       GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param engine        Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    Keypad(PortName rowPort, PortName colPort,
+           const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+           KeypadMode engine = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new keypad object that dispatches its callbacks on a user-supplied queue
+     *
+     * @remark              Multiple keypads can share the same queue (such as the one returned by mbed_event_queue()),
+     *                      so that they do not each need a thread and a queue of their own
+     *
+     * @param userQueue     Event Queue to dispatch callbacks on (must outlive the object and be dispatched by the user)
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param engine        Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    Keypad(EventQueue &userQueue, const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+           KeypadMode engine = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new keypad object whose rows and columns are accessed through GPIO ports, and
+     *                      that dispatches its callbacks on a user-supplied queue
+     *
+     * @remark              Can only be used with a port-mapped backend (such as KeypadPortIO)
+     *
+     * @attention           Every row pin must belong to rowPort and every column pin must belong to colPort
+     *
+     * @param userQueue     Event Queue to dispatch callbacks on (must outlive the object and be dispatched by the user)
+     * @param rowPort       GPIO port to which all the Row Pins of the keypad belong
+     * @param colPort       GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param engine        Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    Keypad(EventQueue &userQueue, PortName rowPort, PortName colPort,
+           const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+           KeypadMode engine = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new keypad object whose rows are shared with the other members of a group
+     *
+     * @remark              Can only be used with the KeypadGroupIO backend (see keypadGroup.h)
+     * @remark              The keypad always uses the KeypadMode::PERIODIC_SCAN mode, and is scanned by the group (in
+     *                      the same pass as the other members), and its callbacks are dispatched on the queue of the
+     *                      group
+     *
+     * @param group         Group that drives the shared rows (must outlive the object)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    Keypad(KeypadGroup<NumRows> &group, const PinName (&colPins)[NumCols]);
+
+    /**
+     * @brief               Initializes the object (see KeypadBase::initialize()), after scanning the whole matrix once
+     *                      to find the buttons that are already held down
+     *
+     * @remark              The buttons found held down by the scan are taken as pressed right away (without waiting for
+     *                      them to finish bouncing), and a KeypadEventType::PRESS event is generated for each of them
+     *                      before the object starts dispatching, so a button held down at boot (or while the object was
+     *                      finalized) is reported as usual, and its long-press and release follow from there
+     * @remark              Buttons that are already tracked are left as they are, so re-initializing does not report
+     *                      them again
+     * @remark              In the KeypadMode::SINGLE_KEY mode, only the first held down button is taken (the same as
+     *                      pressing them one after the other), and in the per-button modes, the buttons of an
+     *                      ambiguous combination are not taken (see Keypad::set_diodes())
+     * @remark              The matrix is not scanned in the KeypadMode::EXTERNAL_SCAN mode, the buttons are picked up
+     *                      from the scans supplied by the application instead
+     *
+     * @attention           Can not call this method from ISR context
+     *
+     * @return              true if the object was successfully initialized, false otherwise (the buttons are not
+     *                      scanned if it was already initialized)
+     *
+     */
+    bool        initialize();
+
+    /**
+     * @brief               Advances the state machine of every button using a scan of the matrix supplied by the
+     *                      application (only in KeypadMode::EXTERNAL_SCAN)
+     *
+     * @remark              Each call counts as one scan period (MATRIX_SCAN_PERIOD) of the debounce, long-press and
+     *                      auto-repeat timings, so the scans must be supplied at that rate
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param frame         Bitmask of held down buttons of each row (bit c is set if the button on column c is held down)
+     *
+     * @return              true if the scan was processed, false if the keypad is not in KeypadMode::EXTERNAL_SCAN
+     *
+     */
+    bool        process_scan(const uint32_t (&frame)[NumRows]);
+
+    /**
+     * @brief               Returns the backend used to access the pins
+     *
+     * @remark              Lets a scanner outside the keypad (such as KeypadScanCapture) use the layout of the pins
+     *
+     * @return              Backend of the keypad
+     *
+     */
+    const IO<NumRows, NumCols> &get_io() const;
+
+    /**
+     * @brief               Feeds a log recorded by a keypad in one of the per-button modes back into the state machines
+     *                      (only in KeypadMode::EXTERNAL_SCAN)
+     *
+     * @remark              The scans are rebuilt from the KeypadRecordKind::KEY_DOWN and KeypadRecordKind::KEY_UP records,
+     *                      and processed once for every MATRIX_SCAN_PERIOD that passed between them (as measured by the
+     *                      times of the records), until the time of the last record, so the replay generates the same
+     *                      events as the recording (the other records are skipped)
+     * @remark              The log is replayed in real time (sleeping for a period after every scan, so that the events
+     *                      are dispatched as usual), except that the time while no button is held down is slept through
+     *                      at once
+     *
+     * @attention           This function must be called from a thread other than the one dispatching the events
+     *
+     * @param log           Log, as read from a KeypadRecorder
+     * @param len           Length of the log (in bytes)
+     *
+     * @return              true if the whole log was replayed, false if the keypad is not in KeypadMode::EXTERNAL_SCAN
+     *                      or the log is malformed (the records before the malformed one are still replayed)
+     *
+     */
+    bool        replay(const uint8_t *log, uint32_t len);
+
+    /**
+     * @brief               Returns the engine used to track the buttons
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Mode that the object was constructed with
+     *
+     */
+    KeypadMode  get_mode() const;
+
+    /**
+     * @brief               Sets a fixed debounce window for every button on the keypad (disables adaptive debouncing)
+     *
+     * @remark              In the per-button modes, the window is rounded up to a whole number of matrix scans
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param window        Duration of time a button must be stable to finish bouncing (1ms to 255ms)
+     *
+     * @return              true if the window was set, false if it was out of range
+     *
+     */
+    bool        set_debounce(std::chrono::milliseconds window);
+
+    /**
+     * @brief               Returns the fixed debounce window (see Keypad::set_debounce())
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Debounce window used while adaptive debouncing is disabled
+     *
+     */
+    std::chrono::milliseconds get_debounce() const;
+
+    /**
+     * @brief               Enables adaptive debouncing, which learns the debounce window of each button from the edges
+     *                      it produces while bouncing
+     *
+     * @remark              Every button uses the largest window until its bounces are observed, after which the window
+     *                      shrinks towards twice the bounce observed on the button, and grows right away whenever a
+     *                      longer bounce (or a press that does not survive the window) is observed
+     * @remark              Only supported in the KeypadMode::SINGLE_KEY mode, as the other modes do not time the edges
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param minWindow     Smallest debounce window that may be used (atleast 1ms)
+     * @param maxWindow     Largest debounce window that may be used (atmost 255ms)
+     *
+     * @return              true if adaptive debouncing was enabled, false if the bounds or the mode were invalid
+     *
+     */
+    bool        set_adaptive_debounce(std::chrono::milliseconds minWindow, std::chrono::milliseconds maxWindow);
+
+    /**
+     * @brief               Checks if adaptive debouncing is enabled
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if adaptive debouncing is enabled, false otherwise
+     *
+     */
+    bool        is_adaptive_debounce() const;
+
+    /**
+     * @brief               Returns the debounce window currently used for a button
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     * @return              Learned window of the button if adaptive debouncing is enabled, the fixed window otherwise
+     *
+     */
+    std::chrono::milliseconds get_key_debounce(uint32_t r, uint32_t c) const;
+
+    /**
+     * @brief               Enables or disables eager press reporting
+     *
+     * @remark              While enabled, the rows are scanned right away on the first edge of a press and the press is
+     *                      reported immediately, after which the edges of the button are ignored for the debounce
+     *                      window (the hold-off)
+     * @remark              If the button is no longer held down at the end of the hold-off, the press is taken to be
+     *                      noise and a KeypadEventType::CANCEL event is generated instead of a release
+     * @remark              Only supported in the KeypadMode::SINGLE_KEY mode
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param enable        Whether presses should be reported eagerly
+     *
+     * @return              true if the setting was applied, false if the mode does not support it
+     *
+     */
+    bool        set_eager_press(bool enable);
+
+    /**
+     * @brief               Checks if eager press reporting is enabled
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if presses are reported eagerly, false otherwise
+     *
+     */
+    bool        is_eager_press() const;
+
+    /**
+     * @brief               Enables auto-repeat (typematic) events, which are generated while a button is held down
+     *
+     * @remark              The first repeat is generated after the delay (counted from the press being reported), and
+     *                      the following ones after the period, which shortens by an eighth on every repeat until it
+     *                      reaches the shortest period (the period stays fixed if both are equal)
+     * @remark              The repeats are driven by the timer that detects long-presses (or by the matrix scans in the
+     *                      per-button modes, which rounds the period up to a multiple of the scan period), so no other
+     *                      timers are used
+     * @remark              In the per-button modes, only the button that was pressed latest repeats
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param delay         Time from a press to its first repeat (atleast the long-press threshold of 300 milliseconds)
+     * @param period        Time between the first two repeats
+     * @param minPeriod     Shortest time between two repeats (atmost the period, 0 for a fixed period)
+     *
+     * @return              true if auto-repeat was enabled, false if the timings are out of range
+     *
+     */
+    bool        set_auto_repeat(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                                std::chrono::milliseconds minPeriod = std::chrono::milliseconds(0));
+
+    /**
+     * @brief               Disables auto-repeat events (see Keypad::set_auto_repeat())
+     *
+     * @remark              A button that is currently repeating stops when its next repeat is due (without generating it)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        disable_auto_repeat();
+
+    /**
+     * @brief               Checks if auto-repeat is enabled
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if held down buttons generate repeats, false otherwise
+     *
+     */
+    bool        is_auto_repeat() const;
+
+    /**
+     * @brief               Sets whether the matrix has diodes on its buttons, which controls ghost detection
+     *
+     * @remark              On a matrix without diodes, three buttons held down on the corners of a rectangle make the
+     *                      fourth corner read as held down too (a ghost), so the combination is ambiguous
+     * @remark              Unless the matrix has diodes, the buttons on the rows and columns of an ambiguous
+     *                      combination keep their current state (already held down buttons stay held down, while new
+     *                      presses are not accepted) until the combination is resolved, and the suppression is counted
+     *                      in the counters (see KeypadBase::get_counters())
+     * @remark              Ghost detection is enabled by default, and only applies to the per-button modes (only a
+     *                      single button is ever tracked in the KeypadMode::SINGLE_KEY mode)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param hasDiodes     Whether the matrix has diodes (which disables ghost detection)
+     *
+     */
+    void        set_diodes(bool hasDiodes);
+
+    /**
+     * @brief               Checks if the matrix is taken to have diodes on its buttons (see Keypad::set_diodes())
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if ghost detection is disabled, false otherwise
+     *
+     */
+    bool        has_diodes() const;
+
+    /**
+     * @brief               Subscribes (or unsubscribes) a button to a type of event
+     *
+     * @remark              An event of a button that is not subscribed to its type is discarded in ISR context, before
+     *                      the immediate callback is called or the event is queued (it is still recorded to the log,
+     *                      see Keypad::set_recorder()), and is counted as filtered (see keypad_counters)
+     * @remark              Every button is subscribed to every type by default
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param type          Type of the event
+     * @param r             Row of the button
+     * @param c             Column of the button
+     * @param subscribed    true to deliver the events of the button, false to discard them
+     *
+     * @return              true if the subscription was changed, false if the button does not exist
+     *
+     */
+    bool        set_subscribed(KeypadEventType type, uint32_t r, uint32_t c, bool subscribed);
+
+    /**
+     * @brief               Sets the buttons that are subscribed to a type of event, all at once
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param type          Type of the event
+     * @param keys          Bitmask of the subscribed buttons of each row (bit c is set if the button on column c is
+     *                      subscribed)
+     *
+     */
+    void        set_subscriptions(KeypadEventType type, const uint32_t (&keys)[NumRows]);
+
+    /**
+     * @brief               Checks if a button is subscribed to a type of event
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param type          Type of the event
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     * @return              true if the events of the button are delivered, false if they are discarded (or the button
+     *                      does not exist)
+     *
+     */
+    bool        is_subscribed(KeypadEventType type, uint32_t r, uint32_t c) const;
+
+    /**
+     * @brief               Makes a button a priority button (or a normal one)
+     *
+     * @remark              The events of priority buttons are queued on a ring of their own (of length
+     *                      KEYPAD_PRIORITY_RING_LEN), which is drained before the ring of the other events, so they
+     *                      are dispatched ahead of the events of normal buttons that are still waiting (the events of
+     *                      each kind of button are still dispatched in the order they were generated)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     * @param priority      true to make the button a priority button, false to make it a normal one
+     *
+     * @return              true if the priority was changed, false if the button does not exist
+     *
+     */
+    bool        set_priority(uint32_t r, uint32_t c, bool priority);
+
+    /**
+     * @brief               Checks if a button is a priority button
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     * @return              true if the button is a priority button, false otherwise (or if it does not exist)
+     *
+     */
+    bool        is_priority(uint32_t r, uint32_t c) const;
+
+    /**
+     * @brief               Copies the latest raw scan of the matrix (before debouncing and ghost detection)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param frame         Location where the bitmask of held down buttons of each row is stored (bit c is set if the
+     *                      button on column c was held down)
+     *
+     * @return              true if the scan was copied, false if the mode does not scan the matrix
+     *                      (KeypadMode::SINGLE_KEY)
+     *
+     */
+    bool        get_scan(uint32_t (&frame)[NumRows]) const;
+
+    /**
+     * @brief               Copies the bitmask of the buttons that are currently held down
+     *
+     * @remark              The bitmask is kept up to date by the state machines (a button is set once its press is
+     *                      reported, and cleared once its release or cancel is), so the buttons are not scanned and the
+     *                      copy takes the same time irrespective of the state of the keypad
+     * @remark              Unlike Keypad::get_scan(), the state is debounced, and includes the buttons of an ambiguous
+     *                      combination that were held down before it (see Keypad::set_diodes())
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param keys          Location where the bitmask of held down buttons of each row is stored (bit c is set if the
+     *                      button on column c is held down)
+     *
+     */
+    void        current_state(uint32_t (&keys)[NumRows]) const;
+
+    /**
+     * @brief               Checks if the object itself currently holds a deep sleep lock
+     *
+     * @remark              Only describes what this keypad requests (derived from its mode, its state and whether
+     *                      KEYPAD_LOW_POWER is defined), other drivers may still hold locks of their own, so whether the
+     *                      MCU can actually enter deep sleep is returned by sleep_manager_can_deep_sleep()
+     * @remark              While idle (no button held down), all the rows are driven and no timer is pending, so only
+     *                      a column interrupt can wake the MCU up, and nothing is locked
+     * @remark              While buttons are being tracked, the pending timers lock deep sleep, unless
+     *                      KEYPAD_LOW_POWER is defined (and the target has a low power ticker)
+     * @remark              In the KeypadMode::PERIODIC_SCAN mode, the ticker is always running, so deep sleep is always
+     *                      locked unless KEYPAD_LOW_POWER is defined
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if a pending timer of the object holds a deep sleep lock, false otherwise
+     *
+     */
+    bool        holds_deep_sleep_lock() const;
+
+private:
+
+    /**
+     * @brief               Sets up the pins and registers the handlers once the backend has been constructed
+     *
+     */
+    void        setup ();
+
+    /**
+     * @brief               Registers the fall and rise handlers of every column pin
+     *
+     * @tparam Cols         Indices of all the columns of the keypad
+     *
+     */
+    template <uint32_t... Cols>
+    void        attach_handlers (std::integer_sequence<uint32_t, Cols...>);
+
+    /**
+     * @brief               Handler for when a fall interrupt is received on a column pin
+     *
+     * @tparam curCol       The column of the keypad that this handler should cater to
+     *
+     */
+    template <uint32_t curCol>
+    void        fall_handler ();
+
+    /**
+     * @brief               Handler for a when a rise interrupt is received on a column pin
+     *
+     * @tparam curCol       The column of the keypad that this handler should cater to
+     *
+     */
+    template <uint32_t curCol>
+    void        rise_handler ();
+
+    /**
+     * @brief               Drives one row at a time to find the row of the held down button on a column
+     *
+     * @param c             Column of the button
+     * @param row           Location where the row of the button is stored (only used if a button was found)
+     *
+     * @return              true if a held down button was found on the column, false otherwise
+     *
+     */
+    bool        scan_rows (uint32_t c, uint32_t &row);
+
+    /**
+     * @brief               Scans the rows after a button press on a column was detected to determine its row
+     *
+     * @tparam curCol       The column of the keypad that this handler should cater to
+     *
+     */
+    template <uint32_t curCol>
+    void        row_scan_handler ();
+
+    /**
+     * @brief               Scans the eagerly reported button at the end of the hold-off to either confirm the press or
+     *                      cancel it
+     *
+     */
+    void        eager_verify_handler ();
+
+    /**
+     * @brief               Scans the previously pressed button after a button release was detected to confirm
+     *
+     */
+    void        button_scan_handler ();
+
+    /**
+     * @brief               Transitions a button to the long-pressed state onec it has been held down
+     *                      past the threshold duration
+     *
+     */
+    void        long_press_handler ();
+
+    /**
+     * @brief               Generates the next repeat of the held down button and schedules the one after it in
+     *                      single-key mode
+     *
+     */
+    void        repeat_handler ();
+
+    /**
+     * @brief               Starts repeating a button that was just long-pressed
+     *
+     * @return              Time to wait until the first repeat
+     *
+     */
+    std::chrono::milliseconds start_repeat();
+
+    /**
+     * @brief               Posts a repeat of a button and accelerates the period of the following ones
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     * @return              Time to wait until the next repeat
+     *
+     */
+    std::chrono::milliseconds post_repeat(uint32_t r, uint32_t c);
+
+    /**
+     * @brief               Returns the debounce window to wait for after an edge on a column in single-key mode
+     *
+     * @remark              While adaptive debouncing is enabled, this is the largest window of the observed buttons on
+     *                      the column, as the row of the button is not known until the rows are scanned
+     *
+     * @param c             Column on which the edge was received
+     *
+     * @return              Debounce window
+     *
+     */
+    std::chrono::milliseconds column_debounce (uint32_t c) const;
+
+    /**
+     * @brief               Records the time of an edge for adaptive debouncing (has no effect while it is disabled)
+     *
+     * @param start         Whether the edge starts a new bouncing period
+     *
+     */
+    void        track_bounce (bool start);
+
+    /**
+     * @brief               Updates the learned debounce window of a button once its bouncing period is confirmed
+     *
+     * @param k             Index of the button (row * NumCols + col)
+     *
+     */
+    void        learn_debounce (uint32_t k);
+
+    /**
+     * @brief               Starts scanning the matrix periodically (if not already doing so) after an edge is
+     *                      received on any column pin in rollover mode
+     *
+     */
+    void        matrix_edge_handler ();
+
+    /**
+     * @brief               Scans the entire matrix and advances the state machine of every button in rollover mode
+     *
+     * @remark              Keeps re-arming itself for as long as any button is not in the RELEASED state
+     *
+     */
+    void        matrix_scan_handler ();
+
+    /**
+     * @brief               Scans the entire matrix and advances the state machine of every button on every tick in
+     *                      periodic-scan mode
+     *
+     */
+    void        periodic_scan_handler ();
+
+    /**
+     * @brief               Performs one step of a scan of the group that the keypad is a member of (see KeypadGroup)
+     *
+     * @param step          0 while all the rows are driven, r + 1 while only row r is driven, and NumRows + 1 once every
+     *                      row was scanned
+     *
+     * @return              true if any column of the keypad is active (only meaningful for step 0)
+     *
+     */
+    bool        group_scan_handler (uint32_t step);
+
+    /**
+     * @brief               Reads the state of every button on the matrix
+     *
+     * @param frame         Location where the bitmask of held down buttons of each row is stored (bit c is set if the
+     *                      button on column c is held down)
+     *
+     */
+    void        scan_matrix (uint32_t (&frame)[NumRows]);
+
+    /**
+     * @brief               Scans the whole matrix and takes the buttons that are held down as pressed (see
+     *                      Keypad::initialize())
+     *
+     */
+    void        snapshot ();
+
+    /**
+     * @brief               Advances the state machine of every button using the result of a scan
+     *
+     * @param frame         Bitmask of held down buttons of each row (see Keypad::scan_matrix())
+     *
+     * @return              true if any button is not in the RELEASED state after the update, false otherwise
+     *
+     */
+    bool        process_frame (const uint32_t (&frame)[NumRows]);
+
+    /**
+     * @brief               Processes the same scan a number of times, one period apart (see Keypad::replay())
+     *
+     * @param frame         Bitmask of held down buttons of each row
+     * @param scans         Number of scans
+     *
+     */
+    void        replay_scans (const uint32_t (&frame)[NumRows], uint32_t scans);
+
+    /**
+     * @brief               Finds the buttons that are part of an ambiguous combination (ghosting) in a scan
+     *
+     * @param frame         Bitmask of held down buttons of each row (see Keypad::scan_matrix())
+     * @param ghosts        Location where the bitmask of ambiguous buttons of each row is stored
+     *
+     * @return              true if any combination is ambiguous, false otherwise
+     *
+     */
+    static bool find_ghosts (const uint32_t (&frame)[NumRows], uint32_t (&ghosts)[NumRows]);
+
+    /**
+     * @brief               Advances the state machine of a single button in the per-button modes
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     * @param down          Whether the button was found to be held down in the latest scan
+     *
+     */
+    void        step_key (uint32_t r, uint32_t c, bool down);
+
+    /**
+     * @brief               Returns the state of a button from the packed per-button states
+     *
+     * @param k             Index of the button (row * NumCols + col)
+     *
+     * @return              State of the button
+     *
+     */
+    ButtonState get_key_state (uint32_t k) const;
+
+    /**
+     * @brief               Updates the state of a button in the packed per-button states
+     *
+     * @remark              Also updates the bitmasks of held and timed buttons and the number of buttons that are not
+     *                      released (see Keypad::process_frame()), and the bitmask of the buttons that are held down
+     *                      (see Keypad::current_state())
+     *
+     * @param k             Index of the button (row * NumCols + col)
+     * @param s             New state of the button
+     *
+     */
+    void        set_key_state (uint32_t k, ButtonState s);
+
+    /**
+     * @brief               Marks whether the button tracked in the KeypadMode::SINGLE_KEY mode is held down (see
+     *                      Keypad::current_state())
+     *
+     * @param down          Whether the press of the button was reported (false once its release or cancel is)
+     *
+     */
+    void        set_down (bool down);
+};
+
+#include "keypad.tpp"
 
 #endif //__KEYPAD_H__
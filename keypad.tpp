@@ -0,0 +1,1368 @@
+/**
+ * @file                    keypad.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the Keypad class template (included by keypad.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+/** Duration of time a button spends bouncing before stabilizing */
+constexpr auto DEBOUNCE_THRESH = 60ms;
+
+/** Duration of time a button must be pressed to be considered long-pressed */
+constexpr auto LONG_PRESS_THRESH = 300ms;
+
+/** Duration of time between consecutive scans of the matrix in the per-button modes */
+constexpr auto MATRIX_SCAN_PERIOD = 10ms;
+
+/** Number of consecutive scans for which a button must be stable in the per-button modes to finish bouncing */
+constexpr uint32_t DEBOUNCE_SCANS = DEBOUNCE_THRESH / MATRIX_SCAN_PERIOD;
+
+/** Number of consecutive scans for which a button must be held down in the per-button modes to be long-pressed */
+constexpr uint32_t LONG_PRESS_SCANS = LONG_PRESS_THRESH / MATRIX_SCAN_PERIOD;
+
+/** Longest debounce window that can be set on a keypad (the windows are stored in a byte) */
+constexpr auto DEBOUNCE_MAX = 255ms;
+
+static_assert(DEBOUNCE_SCANS > 0, "Matrix scan period must not be longer than the debounce threshold!");
+static_assert(DEBOUNCE_THRESH <= DEBOUNCE_MAX, "Debounce threshold must fit in a byte!");
+static_assert(LONG_PRESS_SCANS < 256, "Matrix scan counts must fit in a byte!");
+
+// Constructors
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+Keypad<NumRows, NumCols, IO>::Keypad(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                     KeypadMode engine)
+        : io(rowPins, colPins)
+        , mode(engine)
+{
+    setup();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+Keypad<NumRows, NumCols, IO>::Keypad(PortName rowPort, PortName colPort,
+                                     const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                     KeypadMode engine)
+        : io(rowPort, colPort, rowPins, colPins)
+        , mode(engine)
+{
+    setup();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+Keypad<NumRows, NumCols, IO>::Keypad(EventQueue &userQueue,
+                                     const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                     KeypadMode engine)
+        : KeypadBase(userQueue)
+        , io(rowPins, colPins)
+        , mode(engine)
+{
+    setup();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+Keypad<NumRows, NumCols, IO>::Keypad(EventQueue &userQueue, PortName rowPort, PortName colPort,
+                                     const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                     KeypadMode engine)
+        : KeypadBase(userQueue)
+        , io(rowPort, colPort, rowPins, colPins)
+        , mode(engine)
+{
+    setup();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+Keypad<NumRows, NumCols, IO>::Keypad(KeypadGroup<NumRows> &group, const PinName (&colPins)[NumCols])
+        : KeypadBase(group.get_queue())
+        , io(group, colPins)
+        , mode(KeypadMode::PERIODIC_SCAN)
+{
+    // same as setup(), except that the matrix is scanned by the group instead of a ticker of its own
+
+    debounceMs = static_cast<uint8_t>(DEBOUNCE_THRESH.count());
+    debounceScans = static_cast<uint8_t>(DEBOUNCE_SCANS);
+    attach_key_masks(keyFilters, NumRows);
+
+#if defined(KEYPAD_ISR_STATS)
+    keypad_cycles_enable();
+#endif
+
+    io.join(callback(this, &Keypad::group_scan_handler));
+}
+
+// Public Methods
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::initialize() {
+
+    // the events of the buttons found by the snapshot stay in the ring until the object starts dispatching them
+
+    if (is_initialized()) {
+        return false;
+    }
+
+    snapshot();
+    return KeypadBase::initialize();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::process_scan(const uint32_t (&frame)[NumRows]) {
+
+    if (mode != KeypadMode::EXTERNAL_SCAN) {
+        return false;
+    }
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::EXTERNAL_SCAN);
+#endif
+
+    process_frame(frame);
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+const IO<NumRows, NumCols> &
+Keypad<NumRows, NumCols, IO>::get_io() const {
+    return io;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::replay(const uint8_t *log, uint32_t len) {
+
+    // the log only holds the buttons that changed, so the frame is rebuilt from the latest scan and every record
+    // changes a single button of it
+    // a record that is (about) a whole number of periods after the scan being rebuilt belongs to a later scan, so the
+    // scan being rebuilt is processed, followed by a scan for each period in between (which read the same frame)
+    // the records that belong to the first scan of the log only set up its frame, and the last scan is processed once
+    // every record was read, along with the scans until the time of the last record (such as the ones that generated
+    // its final long-presses and repeats)
+
+    if (mode != KeypadMode::EXTERNAL_SCAN) {
+        return false;
+    }
+
+    const uint32_t periodUs = std::chrono::duration_cast<std::chrono::microseconds>(MATRIX_SCAN_PERIOD).count();
+
+    uint32_t frame[NumRows];
+    get_scan(frame);
+
+    const uint8_t *pos = log;
+    const uint8_t *const end = log + len;
+
+    uint32_t nowUs = 0;
+    uint32_t scanUs = 0;
+    bool started = false;
+
+    while (pos != end) {
+
+        keypad_record rec;
+        if (!KeypadRecorder::decode(pos, end, &rec)) {
+            return false;
+        }
+        nowUs += rec.deltaUs;
+
+        if (rec.kind != KeypadRecordKind::KEY_DOWN && rec.kind != KeypadRecordKind::KEY_UP) {
+            continue;
+        }
+        if (rec.r >= NumRows || rec.c >= NumCols) {
+            return false;
+        }
+
+        const uint32_t scans = started ? (nowUs - scanUs + periodUs / 2) / periodUs : 0;
+        if (scans != 0) {
+
+            replay_scans(frame, scans);
+            scanUs = nowUs;
+        }
+        else if (!started) {
+
+            started = true;
+            scanUs = nowUs;
+        }
+
+        if (rec.kind == KeypadRecordKind::KEY_DOWN) {
+            frame[rec.r] |= 1U << rec.c;
+        }
+        else {
+            frame[rec.r] &= ~(1U << rec.c);
+        }
+    }
+
+    if (started) {
+
+        replay_scans(frame, (nowUs - scanUs + periodUs / 2) / periodUs + 1);
+    }
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+KeypadMode
+Keypad<NumRows, NumCols, IO>::get_mode() const {
+    return mode;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_eager_press(bool enable) {
+
+    if (mode != KeypadMode::SINGLE_KEY) {
+        return false;
+    }
+
+    eager = enable;
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::is_eager_press() const {
+    return eager;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_auto_repeat(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                                              std::chrono::milliseconds minPeriod) {
+
+    // the timings are stored in 16 bits, and the first repeat can not come before the long-press
+
+    constexpr auto REPEAT_MAX = std::chrono::milliseconds(UINT16_MAX);
+
+    if (delay < LONG_PRESS_THRESH || delay > REPEAT_MAX || period.count() < 1 || period > REPEAT_MAX) {
+        return false;
+    }
+
+    if (minPeriod.count() < 0 || minPeriod > period) {
+        return false;
+    }
+
+    CriticalSectionLock lock;
+
+    repeat = true;
+    repeatDelayMs = static_cast<uint16_t>(delay.count());
+    repeatPeriodMs = static_cast<uint16_t>(period.count());
+    repeatMinMs = static_cast<uint16_t>((minPeriod.count() == 0) ? period.count() : minPeriod.count());
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::disable_auto_repeat() {
+    repeat = false;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::is_auto_repeat() const {
+    return repeat;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::set_diodes(bool hasDiodes) {
+    diodes = hasDiodes;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::has_diodes() const {
+    return diodes;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_subscribed(KeypadEventType type, uint32_t r, uint32_t c, bool subscribed) {
+
+    // the bitmasks hold the filtered out buttons, so that the zero-initialized bitmasks subscribe every button
+
+    if (r >= NumRows || c >= NumCols || static_cast<uint32_t>(type) >= KEYPAD_NUM_EVENT_TYPES) {
+        return false;
+    }
+
+    auto *mask = &keyFilters[static_cast<uint32_t>(type) * NumRows + r];
+
+    if (subscribed) {
+        core_util_atomic_fetch_and_u32(mask, ~(1U << c));
+    }
+    else {
+        core_util_atomic_fetch_or_u32(mask, 1U << c);
+    }
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::set_subscriptions(KeypadEventType type, const uint32_t (&keys)[NumRows]) {
+
+    if (static_cast<uint32_t>(type) >= KEYPAD_NUM_EVENT_TYPES) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        core_util_atomic_store_u32(&keyFilters[static_cast<uint32_t>(type) * NumRows + i], ~keys[i] & AllCols);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::is_subscribed(KeypadEventType type, uint32_t r, uint32_t c) const {
+
+    if (r >= NumRows || c >= NumCols || static_cast<uint32_t>(type) >= KEYPAD_NUM_EVENT_TYPES) {
+        return false;
+    }
+
+    return (keyFilters[static_cast<uint32_t>(type) * NumRows + r] & (1U << c)) == 0;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_priority(uint32_t r, uint32_t c, bool priority) {
+
+    if (r >= NumRows || c >= NumCols) {
+        return false;
+    }
+
+    auto *mask = &keyFilters[KEYPAD_NUM_EVENT_TYPES * NumRows + r];
+
+    if (priority) {
+        core_util_atomic_fetch_or_u32(mask, 1U << c);
+    }
+    else {
+        core_util_atomic_fetch_and_u32(mask, ~(1U << c));
+    }
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::is_priority(uint32_t r, uint32_t c) const {
+
+    if (r >= NumRows || c >= NumCols) {
+        return false;
+    }
+
+    return (keyFilters[KEYPAD_NUM_EVENT_TYPES * NumRows + r] & (1U << c)) != 0;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::get_scan(uint32_t (&frame)[NumRows]) const {
+
+    if (mode == KeypadMode::SINGLE_KEY) {
+        return false;
+    }
+
+    CriticalSectionLock lock;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        frame[i] = lastFrame[i];
+    }
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::current_state(uint32_t (&keys)[NumRows]) const {
+
+    CriticalSectionLock lock;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        keys[i] = downKeys[i];
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::holds_deep_sleep_lock() const {
+
+    // the timers are only pending while a button is not released (the long-press timer is detached on release)
+
+#if defined(KEYPAD_LOW_POWER) && DEVICE_LPTICKER
+    return false;
+#else
+    switch (mode) {
+
+    case KeypadMode::SINGLE_KEY:
+        return state != ButtonState::RELEASED;
+
+    case KeypadMode::ROLLOVER:
+        return scanning;
+
+    case KeypadMode::PERIODIC_SCAN:
+        return true;
+
+    case KeypadMode::EXTERNAL_SCAN:
+        return false;
+    }
+
+    return false;
+#endif
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_debounce(std::chrono::milliseconds window) {
+
+    // the number of scans is rounded up, so that the window is never shorter than requested
+
+    if (window.count() < 1 || window > DEBOUNCE_MAX) {
+        return false;
+    }
+
+    CriticalSectionLock lock;
+
+    adaptive = false;
+    debounceMs = static_cast<uint8_t>(window.count());
+    debounceScans = static_cast<uint8_t>((window + MATRIX_SCAN_PERIOD - 1ms) / MATRIX_SCAN_PERIOD);
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+std::chrono::milliseconds
+Keypad<NumRows, NumCols, IO>::get_debounce() const {
+    return std::chrono::milliseconds(debounceMs);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::set_adaptive_debounce(std::chrono::milliseconds minWindow,
+                                                    std::chrono::milliseconds maxWindow) {
+
+    // every button starts out unobserved (a window of 0), and uses the largest window (which is safe on any hardware)
+    // until its bounces have been observed
+
+    if (mode != KeypadMode::SINGLE_KEY) {
+        return false;
+    }
+
+    if (minWindow.count() < 1 || maxWindow > DEBOUNCE_MAX || minWindow > maxWindow) {
+        return false;
+    }
+
+    CriticalSectionLock lock;
+
+    adaptiveMinMs = static_cast<uint8_t>(minWindow.count());
+    adaptiveMaxMs = static_cast<uint8_t>(maxWindow.count());
+
+    for (auto &w : keyDebounceMs) {
+        w = 0;
+    }
+    lastBounceKey = NumKeys;
+
+    adaptive = true;
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::is_adaptive_debounce() const {
+    return adaptive;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+std::chrono::milliseconds
+Keypad<NumRows, NumCols, IO>::get_key_debounce(uint32_t r, uint32_t c) const {
+
+    if (!adaptive) {
+        return std::chrono::milliseconds(debounceMs);
+    }
+
+    const auto w = keyDebounceMs[r * NumCols + c];
+    return std::chrono::milliseconds((w != 0) ? w : adaptiveMaxMs);
+}
+
+// Private Methods
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::setup() {
+
+    // the backend enables the pullups of the columns and drives all the rows low, so that
+    // whenever a button is pressed, its corresponding column is pulled low, i.e. a fall interrupt happens
+    // whenever a button is lifted, its corresponding column is pulled high, i.e. a rise interrupt happens
+    // register fall and rise handlers for each of the interrupt pins (cols)
+    // in periodic-scan mode, the columns are only read by the ticker and their interrupts are left unused
+    // in external-scan mode, the application scans the matrix, so neither the ticker nor the interrupts are used
+
+    debounceMs = static_cast<uint8_t>(DEBOUNCE_THRESH.count());
+    debounceScans = static_cast<uint8_t>(DEBOUNCE_SCANS);
+    attach_key_masks(keyFilters, NumRows);
+
+#if defined(KEYPAD_ISR_STATS)
+    keypad_cycles_enable();
+#endif
+
+    if (mode == KeypadMode::EXTERNAL_SCAN) {
+        return;
+    }
+
+    if (mode == KeypadMode::PERIODIC_SCAN) {
+        scanTicker.attach(callback(this, &Keypad::periodic_scan_handler), MATRIX_SCAN_PERIOD);
+        return;
+    }
+
+    attach_handlers(std::make_integer_sequence<uint32_t, NumCols>{});
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+template <uint32_t... Cols>
+void
+Keypad<NumRows, NumCols, IO>::attach_handlers(std::integer_sequence<uint32_t, Cols...>) {
+
+    // expand the column indices at compile time, so that each column gets its own instantiation of the handlers
+    // (the array only exists to provide a context in which the pack can be expanded)
+
+    using expander = int[];
+
+    (void) expander {0, (io.column(Cols).fall(callback(this, &Keypad::fall_handler<Cols>)), 0)...};
+    (void) expander {0, (io.column(Cols).rise(callback(this, &Keypad::rise_handler<Cols>)), 0)...};
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+template <uint32_t curCol>
+void
+Keypad<NumRows, NumCols, IO>::fall_handler() {
+
+    if (mode == KeypadMode::ROLLOVER) {
+        matrix_edge_handler();
+        return;
+    }
+
+    // the edge is profiled from here on, so that the cost of recording it is accounted to the handler (an edge in
+    // rollover mode is accounted to the matrix edge handler instead)
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::FALL);
+#endif
+
+    record(KeypadRecordKind::COLUMN_FALL, 0, curCol);
+
+    // a fall on another column while a button is held down is another button being pressed, which is rejected
+
+    if (state != ButtonState::RELEASED) {
+
+        if (state == ButtonState::PRESS_BOUNCING || state == ButtonState::RELEASE_BOUNCING) {
+            track_bounce(false);
+        }
+        if (state != ButtonState::PRESS_BOUNCING && curCol != pressedCol) {
+            count_concurrent();
+        }
+        return;
+    }
+
+    track_bounce(true);
+
+#if defined(KEYPAD_LATENCY_STATS)
+    mark_edge();
+#endif
+
+    // in eager mode, find the button and report the press right away, then hold off the edges until verifying it
+    // (the edges caused by scanning the rows arrive while PRESS_BOUNCING, so they are ignored as well)
+
+    if (eager) {
+
+        uint32_t r;
+        if (!scan_rows(curCol, r)) {
+
+            count_bounce();
+            return;
+        }
+
+        //transition_state(ButtonState::RELEASED, ButtonState::PRESS_BOUNCING);
+        state = ButtonState::PRESS_BOUNCING;
+        pressedRow = r;
+        pressedCol = curCol;
+        set_down(true);
+
+        toRowScan.attach(callback(this, &Keypad::eager_verify_handler), get_key_debounce(r, curCol));
+
+        post_event(KeypadEventType::PRESS, r, curCol);
+        return;
+    }
+
+    //transition_state(ButtonState::RELEASED, ButtonState::PRESS_BOUNCING);
+    state = ButtonState::PRESS_BOUNCING;
+    toRowScan.attach(callback(this, &Keypad::row_scan_handler<curCol>), column_debounce(curCol));
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+template <uint32_t curCol>
+void
+Keypad<NumRows, NumCols, IO>::rise_handler() {
+
+    if (mode == KeypadMode::ROLLOVER) {
+        matrix_edge_handler();
+        return;
+    }
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::RISE);
+#endif
+
+    record(KeypadRecordKind::COLUMN_RISE, 0, curCol);
+
+    if (state != ButtonState::PRESSED && state != ButtonState::LONG_PRESSED) {
+
+        if (state == ButtonState::PRESS_BOUNCING || state == ButtonState::RELEASE_BOUNCING) {
+            track_bounce(false);
+        }
+        return;
+    }
+
+    track_bounce(true);
+
+    //transition_state(ButtonState::PRESSED, ButtonState::RELEASE_BOUNCING)
+    //|| transition_state(ButtonState::LONG_PRESSED, ButtonState::RELEASE_BOUNCING);
+    state = ButtonState::RELEASE_BOUNCING;
+    toButtonScan.attach(callback(this, &Keypad::button_scan_handler), get_key_debounce(pressedRow, pressedCol));
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+template <uint32_t curCol>
+void
+Keypad<NumRows, NumCols, IO>::row_scan_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::ROW_SCAN);
+#endif
+
+    if (state != ButtonState::PRESS_BOUNCING) {
+        return;
+    }
+
+    uint32_t r;
+    if (scan_rows(curCol, r)) {
+
+        //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::PRESSED);
+        state = ButtonState::PRESSED;
+        pressedRow = r;
+        pressedCol = curCol;
+        set_down(true);
+        learn_debounce(r * NumCols + curCol);
+
+        toLongPressed.attach(callback(this, &Keypad::long_press_handler), LONG_PRESS_THRESH);
+
+        post_event(KeypadEventType::PRESS, r, curCol);
+        return;
+    }
+
+    //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::RELEASED);
+    state = ButtonState::RELEASED;
+    count_bounce();
+
+    // the press did not survive the window, so the window of every observed button on the column is too short (the
+    // row of the button is not known), double them so that a worn button does not keep getting rejected
+
+    if (adaptive) {
+        for (uint32_t i = 0; i < NumRows; ++i) {
+
+            auto &w = keyDebounceMs[i * NumCols + curCol];
+            w = static_cast<uint8_t>((w * 2U < adaptiveMaxMs) ? w * 2U : adaptiveMaxMs);
+        }
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::scan_rows(uint32_t c, uint32_t &row) {
+
+    // drive one row at a time, the column stays pulled low only while the row of the pressed button is driven
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        io.drive(1U << i);
+        if (io.read(1U << c)) {
+
+            io.drive(AllRows);
+
+            row = i;
+            return true;
+        }
+    }
+
+    io.drive(AllRows);
+    return false;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::eager_verify_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::EAGER_VERIFY);
+#endif
+
+    // the press was already reported, if the button is still held down it becomes a regular press (whose long-press
+    // threshold counts from the first edge), otherwise the press is cancelled
+
+    if (state != ButtonState::PRESS_BOUNCING) {
+        return;
+    }
+
+    const auto curRow = pressedRow;
+    const auto curCol = pressedCol;
+    const auto holdoff = get_key_debounce(curRow, curCol);
+
+    io.drive(1U << curRow);
+    const auto on = io.read(1U << curCol);
+    io.drive(AllRows);
+
+    if (!on) {
+
+        //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::RELEASED);
+        state = ButtonState::RELEASED;
+        set_down(false);
+        count_bounce();
+
+        post_event(KeypadEventType::CANCEL, curRow, curCol);
+        return;
+    }
+
+    //transition_state(ButtonState::PRESS_BOUNCING, ButtonState::PRESSED);
+    state = ButtonState::PRESSED;
+    learn_debounce(curRow * NumCols + curCol);
+
+    toLongPressed.attach(callback(this, &Keypad::long_press_handler),
+                         (holdoff < LONG_PRESS_THRESH) ? LONG_PRESS_THRESH - holdoff : 1ms);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::button_scan_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::BUTTON_SCAN);
+#endif
+
+    if (state != RELEASE_BOUNCING) {
+        return;
+    }
+
+    auto curRow = pressedRow;
+    auto curCol = pressedCol;
+
+    if (io.read(1U << pressedCol)) {
+
+        //transition_state(ButtonState::RELEASE_BOUNCING, ButtonState::PRESSED);
+        state = ButtonState::PRESSED;
+        return;
+    }
+
+    //transition_state(ButtonState::RELEASE_BOUNCING, ButtonState::RELEASED);
+    state = ButtonState::RELEASED;
+    set_down(false);
+    learn_debounce(curRow * NumCols + curCol);
+    if (toLongPressed.remaining_time().count() > 0) {
+        toLongPressed.detach();
+    }
+
+    post_event(KeypadEventType::RELEASE, curRow, curCol);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::long_press_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::LONG_PRESS);
+#endif
+
+    if (state != ButtonState::PRESSED) {
+        return;
+    }
+
+    auto curRow = pressedRow;
+    auto curCol = pressedCol;
+
+    //transition_state(ButtonState::PRESSED, ButtonState::LONG_PRESSED);
+    state = ButtonState::LONG_PRESSED;
+
+    // the long-press timer is reused to schedule the repeats, it is detached when the button is released
+
+    if (repeat) {
+        toLongPressed.attach(callback(this, &Keypad::repeat_handler), start_repeat());
+    }
+
+    post_event(KeypadEventType::LONGPRESS, curRow, curCol);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::repeat_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::REPEAT);
+#endif
+
+    // the button may be bouncing (or may have bounced back to PRESSED) while it is still held down, the chain only
+    // stops once it is released (or auto-repeat is disabled)
+
+    if (!repeat || state == ButtonState::RELEASED || state == ButtonState::PRESS_BOUNCING) {
+        return;
+    }
+
+    toLongPressed.attach(callback(this, &Keypad::repeat_handler), post_repeat(pressedRow, pressedCol));
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+std::chrono::milliseconds
+Keypad<NumRows, NumCols, IO>::start_repeat() {
+
+    repeatFirst = true;
+    repeatCurMs = repeatPeriodMs;
+    repeatWaitMs = static_cast<uint16_t>(repeatDelayMs - LONG_PRESS_THRESH.count());
+    repeatTicks = 0;
+
+    return std::chrono::milliseconds(repeatWaitMs);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+std::chrono::milliseconds
+Keypad<NumRows, NumCols, IO>::post_repeat(uint32_t r, uint32_t c) {
+
+    // the period shrinks by an eighth of its distance to the shortest period (atleast 1 millisecond) on every repeat
+
+    post_event(KeypadEventType::REPEAT, r, c, repeatFirst);
+    repeatFirst = false;
+
+    repeatWaitMs = repeatCurMs;
+    if (repeatCurMs > repeatMinMs) {
+        repeatCurMs -= static_cast<uint16_t>((repeatCurMs - repeatMinMs + 7) / 8);
+    }
+
+    return std::chrono::milliseconds(repeatWaitMs);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+std::chrono::milliseconds
+Keypad<NumRows, NumCols, IO>::column_debounce(uint32_t c) const {
+
+    if (!adaptive) {
+        return std::chrono::milliseconds(debounceMs);
+    }
+
+    // buttons whose bounces have not been observed yet are skipped, if a press on one of them does not survive the
+    // window, the windows of the column grow until it does
+
+    uint8_t w = 0;
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        if (keyDebounceMs[i * NumCols + c] > w) {
+            w = keyDebounceMs[i * NumCols + c];
+        }
+    }
+
+    return std::chrono::milliseconds((w != 0) ? w : adaptiveMaxMs);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::track_bounce(bool start) {
+
+    if (!adaptive) {
+        return;
+    }
+
+    bounceLastUs = us_ticker_read();
+    if (start) {
+        bounceStartUs = bounceLastUs;
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::learn_debounce(uint32_t k) {
+
+    // the target is twice the time between the first and the last edge of the bouncing period (with some margin)
+    // grow to the target right away to stop chatter, but only shrink by a quarter of the difference per period, so
+    // that a single clean press does not undo what was learned from the noisy ones
+    // a period that starts shortly after the previous one on the same button was confirmed is really the same bounce
+    // being reported as separate events (chatter), so the window is doubled instead
+
+    if (!adaptive) {
+        return;
+    }
+
+    auto &w = keyDebounceMs[k];
+
+    const bool chatter = (k == lastBounceKey) && (bounceStartUs - lastConfirmUs < adaptiveMaxMs * 1000U);
+    lastBounceKey = k;
+    lastConfirmUs = us_ticker_read();
+
+    if (chatter && w != 0) {
+        w = static_cast<uint8_t>((w * 2U < adaptiveMaxMs) ? w * 2U : adaptiveMaxMs);
+        return;
+    }
+
+    const uint32_t bounceMs = (bounceLastUs - bounceStartUs) / 1000;
+
+    uint32_t target = bounceMs * 2 + 1;
+    if (target < adaptiveMinMs) {
+        target = adaptiveMinMs;
+    }
+    if (target > adaptiveMaxMs) {
+        target = adaptiveMaxMs;
+    }
+
+    if (w == 0 || target >= w) {
+        w = static_cast<uint8_t>(target);
+    }
+    else {
+        w = static_cast<uint8_t>(w - (w - target + 3) / 4);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::matrix_edge_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::MATRIX_EDGE);
+#endif
+
+    // edges are also caused by the rows being toggled during a scan, these as well as any real edges that arrive while
+    // the matrix is already being scanned are ignored (the next scan will pick them up anyways)
+
+    if (scanning) {
+        return;
+    }
+
+#if defined(KEYPAD_LATENCY_STATS)
+    mark_edge();
+#endif
+
+    scanning = true;
+    toRowScan.attach(callback(this, &Keypad::matrix_scan_handler), MATRIX_SCAN_PERIOD);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::matrix_scan_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::MATRIX_SCAN);
+#endif
+
+    // keep scanning for as long as any button is not released, wait for the next edge otherwise
+
+    uint32_t frame[NumRows];
+    scan_matrix(frame);
+
+    if (process_frame(frame)) {
+        toRowScan.attach(callback(this, &Keypad::matrix_scan_handler), MATRIX_SCAN_PERIOD);
+        return;
+    }
+
+    scanning = false;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::periodic_scan_handler() {
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::PERIODIC_SCAN);
+#endif
+
+    // the ticker re-arms itself, so every tick performs exactly one scan irrespective of the state of the buttons
+
+    uint32_t frame[NumRows];
+    scan_matrix(frame);
+    process_frame(frame);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::group_scan_handler(uint32_t step) {
+
+    // the backend collects the frame while the group drives the rows, only the complete frame is processed (and
+    // accounted as a periodic scan)
+
+    if (step <= NumRows) {
+        return io.scan_step(step);
+    }
+
+#if defined(KEYPAD_ISR_STATS)
+    const IsrProfile profile(*this, KeypadIsr::PERIODIC_SCAN);
+#endif
+
+    process_frame(io.scanned());
+    return false;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::scan_matrix(uint32_t (&frame)[NumRows]) {
+
+    // with all the rows driven low, read the columns to find the ones on which any button is held down
+    // only these columns need to be read while scanning, so that the number of pin reads grows with the number of rows
+    // (and not with the number of buttons) as long as only a few columns are active (a port backend always reads
+    // all of them at once)
+    // to scan a row, drive only that row low and read the active columns, buttons on other rows can not pull them low
+
+    const auto activeCols = io.read(AllCols);
+
+    for (auto &e : frame) {
+        e = 0;
+    }
+
+    if (activeCols == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        io.drive(1U << i);
+        frame[i] = io.read(activeCols);
+    }
+
+    io.drive(AllRows);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::snapshot() {
+
+    // the scan runs with interrupts disabled, so that it does not interleave with a scan of the ticker (or of the
+    // group), and the edges caused by toggling the rows arrive once the state is consistent again
+    // a button that is already held down at this point has long finished bouncing, so it is taken as pressed right
+    // away, the same as once its debounce window runs out
+
+    if (mode == KeypadMode::EXTERNAL_SCAN) {
+        return;
+    }
+
+    CriticalSectionLock lock;
+
+    // in single-key mode, the row of the first active column is found the same way as after a press bounces
+    // (an edge caused by scanning the rows that arrives after the press is taken is verified like a release bounce)
+
+    if (mode == KeypadMode::SINGLE_KEY) {
+
+        if (state != ButtonState::RELEASED) {
+            return;
+        }
+
+        const auto activeCols = io.read(AllCols);
+        if (activeCols == 0) {
+            return;
+        }
+
+        const auto c = static_cast<uint32_t>(__builtin_ctz(activeCols));
+        uint32_t r;
+
+        state = ButtonState::PRESS_BOUNCING;
+        if (!scan_rows(c, r)) {
+
+            state = ButtonState::RELEASED;
+            return;
+        }
+
+        state = ButtonState::PRESSED;
+        pressedRow = r;
+        pressedCol = c;
+        set_down(true);
+
+        toLongPressed.attach(callback(this, &Keypad::long_press_handler), LONG_PRESS_THRESH);
+
+        post_event(KeypadEventType::PRESS, r, c);
+        return;
+    }
+
+    // in rollover mode, the edges caused by scanning the rows are ignored while scanning, and the scans continue
+    // afterwards, which also stops them again if no button was held down
+
+    if (mode == KeypadMode::ROLLOVER && !scanning) {
+
+        scanning = true;
+        toRowScan.attach(callback(this, &Keypad::matrix_scan_handler), MATRIX_SCAN_PERIOD);
+    }
+
+    uint32_t frame[NumRows];
+    uint32_t ghosts[NumRows] {};
+
+    scan_matrix(frame);
+    if (!diodes) {
+        find_ghosts(frame, ghosts);
+    }
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        for (auto changed = frame[i] ^ lastFrame[i]; changed != 0; changed &= changed - 1) {
+
+            const auto c = static_cast<uint32_t>(__builtin_ctz(changed));
+            record((frame[i] & (1U << c)) ? KeypadRecordKind::KEY_DOWN : KeypadRecordKind::KEY_UP, i, c);
+        }
+
+        lastFrame[i] = frame[i];
+
+        for (auto found = frame[i] & ~ghosts[i]; found != 0; found &= found - 1) {
+
+            const auto c = static_cast<uint32_t>(__builtin_ctz(found));
+            const auto k = i * NumCols + c;
+
+            if (get_key_state(k) != ButtonState::RELEASED) {
+                continue;
+            }
+
+            set_key_state(k, ButtonState::PRESSED);
+            keyTicks[k] = 0;
+            latestKey = k;
+            repeatKey = NumKeys;
+            post_event(KeypadEventType::PRESS, i, c);
+        }
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::process_frame(const uint32_t (&frame)[NumRows]) {
+
+    // the buttons of an ambiguous combination are frozen in their current state (and count as not released), so that
+    // held down buttons are not released and ghosts are not pressed
+
+    uint32_t ghosts[NumRows] {};
+    const bool ambiguous = !diodes && find_ghosts(frame, ghosts);
+
+    if (ambiguous && !ghosting) {
+        count_ghost();
+    }
+    ghosting = ambiguous;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        for (auto changed = frame[i] ^ lastFrame[i]; changed != 0; changed &= changed - 1) {
+
+            const auto c = static_cast<uint32_t>(__builtin_ctz(changed));
+            record((frame[i] & (1U << c)) ? KeypadRecordKind::KEY_DOWN : KeypadRecordKind::KEY_UP, i, c);
+        }
+
+        lastFrame[i] = frame[i];
+    }
+
+    // stepping a button is a no-op if it is released and reads released, or it is long-pressed (and not repeating) and
+    // reads held down, so only the buttons whose level differs from the held bitmask, and the timed ones, are stepped
+    // (walking the set bits by counting the trailing zeros), and a row on which nothing moves costs a single compare
+    // whether any button is not released is kept as a count by Keypad::set_key_state(), so it does not need a pass
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        const auto moved = (frame[i] ^ heldKeys[i]) | timedKeys[i];
+        if (moved == 0) {
+            continue;
+        }
+
+        for (auto work = moved & ~ghosts[i]; work != 0; work &= work - 1) {
+
+            const auto c = static_cast<uint32_t>(__builtin_ctz(work));
+            step_key(i, c, frame[i] & (1U << c));
+        }
+    }
+
+    return ambiguous || activeKeys != 0;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::replay_scans(const uint32_t (&frame)[NumRows], uint32_t scans) {
+
+    // sleeping for a period after every scan lets the dispatch thread drain the events in between, the same as with
+    // a ticker
+    // once no button is held down or timed, the rest of the scans do not change any state, so they are slept through
+    // at once
+
+    for (uint32_t i = 0; i < scans; ++i) {
+
+        if (!process_frame(frame)) {
+
+            ThisThread::sleep_for(MATRIX_SCAN_PERIOD * (scans - i));
+            return;
+        }
+
+        ThisThread::sleep_for(MATRIX_SCAN_PERIOD);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+bool
+Keypad<NumRows, NumCols, IO>::find_ghosts(const uint32_t (&frame)[NumRows], uint32_t (&ghosts)[NumRows]) {
+
+    // a ghost needs two rows that share atleast two held down columns (the corners of a rectangle)
+    // comparing every row with the running OR of the rows before it finds the columns held down on atleast two rows in
+    // a single pass, and a row with atleast two of them is part of a rectangle (x & (x - 1) clears the lowest set bit
+    // of x), so the rows are never compared pairwise
+    // (without diodes, a row that shares one column with each of two other rows reads the fourth corner too, so every
+    // row that holds two such columns is found as well)
+
+    uint32_t once = 0;
+    uint32_t twice = 0;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        twice |= once & frame[i];
+        once |= frame[i];
+    }
+
+    if ((twice & (twice - 1)) == 0) {
+        return false;
+    }
+
+    bool found = false;
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        const auto candidates = frame[i] & twice;
+        if ((candidates & (candidates - 1)) != 0) {
+            ghosts[i] = candidates;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::step_key(uint32_t r, uint32_t c, bool down) {
+
+    // the same states as the single-key state machine are used, but bouncing is resolved by counting the number of
+    // consecutive scans for which the button was stable instead of waiting on a timeout, and long-presses are detected
+    // by counting the number of scans for which the button was held down
+    // LONG_RELEASE_BOUNCING remembers that a long-press was already reported, so that bouncing does not report it again
+    // only the button that was pressed latest repeats after its long-press, its repeats are timed by counting scans too
+
+    const auto k = r * NumCols + c;
+    auto &ticks = keyTicks[k];
+
+    switch (get_key_state(k)) {
+
+    case ButtonState::RELEASED:
+        if (!down) {
+            return;
+        }
+        set_key_state(k, ButtonState::PRESS_BOUNCING);
+        ticks = 1;
+        break;
+
+    case ButtonState::PRESS_BOUNCING:
+        if (!down) {
+            set_key_state(k, ButtonState::RELEASED);
+            count_bounce();
+            return;
+        }
+        if (++ticks >= debounceScans) {
+            set_key_state(k, ButtonState::PRESSED);
+            ticks = 0;
+            latestKey = k;
+            repeatKey = NumKeys;
+            post_event(KeypadEventType::PRESS, r, c);
+        }
+        break;
+
+    case ButtonState::PRESSED:
+        if (!down) {
+            set_key_state(k, ButtonState::RELEASE_BOUNCING);
+            ticks = 1;
+        }
+        else if (++ticks >= LONG_PRESS_SCANS) {
+            if (repeat && k == latestKey) {
+                repeatKey = k;
+                start_repeat();
+            }
+            set_key_state(k, ButtonState::LONG_PRESSED);
+            post_event(KeypadEventType::LONGPRESS, r, c);
+        }
+        break;
+
+    case ButtonState::LONG_PRESSED:
+        if (!down) {
+            set_key_state(k, ButtonState::LONG_RELEASE_BOUNCING);
+            ticks = 1;
+        }
+        else if (repeat && k == repeatKey && ++repeatTicks * MATRIX_SCAN_PERIOD.count() >= repeatWaitMs) {
+            repeatTicks = 0;
+            post_repeat(r, c);
+        }
+        break;
+
+    case ButtonState::RELEASE_BOUNCING:
+    case ButtonState::LONG_RELEASE_BOUNCING:
+        if (down) {
+            set_key_state(k, (get_key_state(k) == ButtonState::RELEASE_BOUNCING) ? ButtonState::PRESSED
+                                                                                : ButtonState::LONG_PRESSED);
+            ticks = 0;
+            count_bounce();
+        }
+        else if (++ticks >= debounceScans) {
+            set_key_state(k, ButtonState::RELEASED);
+            if (k == latestKey) {
+                latestKey = NumKeys;
+                repeatKey = NumKeys;
+            }
+            post_event(KeypadEventType::RELEASE, r, c);
+            return;
+        }
+        break;
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+typename Keypad<NumRows, NumCols, IO>::ButtonState
+Keypad<NumRows, NumCols, IO>::get_key_state(uint32_t k) const {
+
+    // even buttons are stored in the lower nibble and odd buttons in the upper nibble of each byte
+
+    return static_cast<ButtonState>((keyStates[k / 2] >> ((k % 2) * 4)) & 0x0F);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::set_key_state(uint32_t k, ButtonState s) {
+
+    const auto prev = get_key_state(k);
+    const auto shift = (k % 2) * 4;
+    keyStates[k / 2] = (keyStates[k / 2] & ~(0x0F << shift)) | (static_cast<uint8_t>(s) << shift);
+
+    if (prev == ButtonState::RELEASED && s != ButtonState::RELEASED) {
+        ++activeKeys;
+    }
+    else if (prev != ButtonState::RELEASED && s == ButtonState::RELEASED) {
+        --activeKeys;
+    }
+
+    // every state other than RELEASED and LONG_PRESSED is timed, and so is the repeating button while LONG_PRESSED
+    // (including when it settles back after bouncing on a release, so that it keeps repeating)
+
+    const auto r = k / NumCols;
+    const auto bit = 1U << (k % NumCols);
+
+    heldKeys[r] = (s == ButtonState::LONG_PRESSED) ? (heldKeys[r] | bit) : (heldKeys[r] & ~bit);
+    timedKeys[r] = (s != ButtonState::RELEASED && (s != ButtonState::LONG_PRESSED || k == repeatKey))
+                       ? (timedKeys[r] | bit)
+                       : (timedKeys[r] & ~bit);
+
+    // a press is reported on entering PRESSED, and a release on entering RELEASED from bouncing (never from
+    // PRESS_BOUNCING, whose press was not reported)
+
+    if (s == ButtonState::PRESSED) {
+        downKeys[r] |= bit;
+    }
+    else if (s == ButtonState::RELEASED) {
+        downKeys[r] &= ~bit;
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO>
+void
+Keypad<NumRows, NumCols, IO>::set_down(bool down) {
+
+    const auto bit = 1U << pressedCol;
+    downKeys[pressedRow] = down ? (downKeys[pressedRow] | bit) : (downKeys[pressedRow] & ~bit);
+}
@@ -2,7 +2,7 @@
  * @file                    KeypadBlocking.h
  * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
  *
- * @brief                   Simple Library to use a 4x4 Keypad sensor with MBed OS
+ * @brief                   Simple Library to use a matrix Keypad sensor with MBed OS
  *
  * @copyright               Copyright (c) 2023
  *
@@ -14,55 +14,114 @@
 #include "keypad.h"
 
 /**
- * @brief                   Class that provides a simple interface to use a 4x4 keypad
+ * @brief                   Class that provides a simple interface to use a matrix keypad
  *
- * @remark                  At a time, only a single button on the keypad can be pressed, pressing multiple buttons
- *                          at the same time will only cause the earliest to be accepted, while all others are rejected
+ * @remark                  In the KeypadMode::SINGLE_KEY mode, only a single button on the keypad can be pressed at a
+ *                          time, pressing multiple buttons at the same time will only cause the earliest to be accepted,
+ *                          while all others are rejected (see Keypad for details)
+ * @remark                  All events are stored in a single ordered stream of packed 32-bit entries, so the relative
+ *                          order of presses, releases and long-presses is preserved, and can be consumed through
+ *                          KeypadBlocking::pop_event()
+ * @remark                  The per-type methods (such as KeypadBlocking::pop_press()) consume the earliest event of
+ *                          their type from the same stream, leaving the events of other types in place
+ * @remark                  The wait methods (such as KeypadBlocking::wait_press()) put the calling thread to sleep until
+ *                          an event arrives, so that consumers do not need to poll
+ * @remark                  While eager press reporting is enabled, a cancelled press is removed from the stream if it has
+ *                          not been consumed yet, otherwise a KeypadEventType::CANCEL event is stored for it
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ * @tparam IO               Backend used to drive the rows and read the columns (see keypadIO.h)
+ * @tparam BufLen           Maximum number of events to queue up before overwriting the oldest one
  */
+template <uint32_t NumRows = KEYPAD_NUM_ROWS, uint32_t NumCols = KEYPAD_NUM_COLS,
+          template <uint32_t, uint32_t> class IO = KeypadPinIO, uint32_t BufLen = KEYPAD_BUFFER_LEN>
 class KeypadBlocking {
 
-    /**
-     * @brief               Structure to encapsulate the coordinates of a button
-     *
-     */
-    struct button_coord {
+    static_assert(BufLen > 0, "KeypadBlocking must be able to buffer atleast one event!");
 
-        /** Row */
-        uint32_t r;
-        /** Column */
-        uint32_t c;
-    };
+    /** Value of the type field of events that were consumed out of order by the per-type methods (never a type) */
+    static constexpr uint32_t ConsumedType = (1U << KEYPAD_EVENT_TYPE_BITS) - 1;
+    /** Number of types of events that are buffered */
+    static constexpr uint32_t NumTypes = KEYPAD_NUM_EVENT_TYPES;
 
     /** Keypad instance that is internally used */
-    Keypad                                          keypad;
+    Keypad<NumRows, NumCols, IO>                    keypad;
+
+    /** Ordered stream of events, where consumed events are marked with ConsumedType until they reach the head */
+    keypad_event                                    events[BufLen] {};
+    /** Index of the earliest event in the stream */
+    uint32_t                                        head {0};
+    /** Number of entries in the stream (including the consumed ones that have not reached the head yet) */
+    uint32_t                                        count {0};
+    /** Number of unconsumed events of each type in the stream */
+    uint32_t                                        available[NumTypes] {};
 
-    /** Ordered list of coordinates of buttons that were pressed */
-    CircularBuffer<button_coord, KEYPAD_BUFFER_LEN> pressBuf;
-    /** Ordered list of coordinates of buttons that were released */
-    CircularBuffer<button_coord, KEYPAD_BUFFER_LEN> releaseBuf;
-    /** Ordered list of coordinates of buttons that were long-pressed */
-    CircularBuffer<button_coord, KEYPAD_BUFFER_LEN> longpressBuf;
+    /** Number of unconsumed events that were overwritten because the stream was full */
+    uint32_t                                        overwritten {0};
 
-    Mutex                                           pressMutex;
-    Mutex                                           releaseMutex;
-    Mutex                                           longpressMutex;
+    /** Flags set whenever an event is pushed (bit t is set for an event of type t) */
+    EventFlags                                      flags;
 
 public:
 
     /**
      * @brief               Construct a new KeypadBlocking object
      *
-     * @param r0            Microcontroller Pin to which Row Pin 0 of the keypad is connected
-     * @param r1            Microcontroller Pin to which Row Pin 1 of the keypad is connected
-     * @param r2            Microcontroller Pin to which Row Pin 2 of the keypad is connected
-     * @param r3            Microcontroller Pin to which Row Pin 3 of the keypad is connected
-     * @param c0            Microcontroller Pin to which Column Pin 0 of the keypad is connected
-     * @param c1            Microcontroller Pin to which Column Pin 1 of the keypad is connected
-     * @param c2            Microcontroller Pin to which Column Pin 2 of the keypad is connected
-     * @param c3            Microcontroller Pin to which Column Pin 3 of the keypad is connected
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param mode          Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    KeypadBlocking(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                   KeypadMode mode = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new KeypadBlocking object whose rows and columns are accessed through GPIO ports
+     *
+     * @remark              Can only be used with a port-mapped backend (such as KeypadPortIO)
+     *
+     * @param rowPort       GPIO port to which all the Row Pins of the keypad belong
+     * @param colPort       GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param mode          Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    KeypadBlocking(PortName rowPort, PortName colPort,
+                   const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                   KeypadMode mode = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new KeypadBlocking object whose internal keypad object pushes its events on a
+     *                      user-supplied queue (see Keypad)
+     *
+     * @param queue         Event Queue to push events on (must outlive the object and be dispatched by the user)
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param mode          Engine used to track the buttons (see KeypadMode)
+     *
+     */
+    KeypadBlocking(EventQueue &queue, const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                   KeypadMode mode = KeypadMode::SINGLE_KEY);
+
+    /**
+     * @brief               Construct a new KeypadBlocking object whose rows and columns are accessed through GPIO ports,
+     *                      and whose internal keypad object pushes its events on a user-supplied queue (see Keypad)
+     *
+     * @remark              Can only be used with a port-mapped backend (such as KeypadPortIO)
+     *
+     * @param queue         Event Queue to push events on (must outlive the object and be dispatched by the user)
+     * @param rowPort       GPIO port to which all the Row Pins of the keypad belong
+     * @param colPort       GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     * @param mode          Engine used to track the buttons (see KeypadMode)
      *
      */
-    KeypadBlocking(PinName r0, PinName r1, PinName r2, PinName r3, PinName c0, PinName c1, PinName c2, PinName c3);
+    KeypadBlocking(EventQueue &queue, PortName rowPort, PortName colPort,
+                   const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                   KeypadMode mode = KeypadMode::SINGLE_KEY);
 
     /**
      * @brief               Initializes the internal keypad object (See Keypad::initialize())
@@ -105,6 +164,137 @@ public:
      */
     bool            is_initialized() const;
 
+    /**
+     * @brief               Enables or disables eager press reporting of the internal keypad object (see
+     *                      Keypad::set_eager_press())
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param enable        Whether presses should be reported eagerly
+     *
+     * @return              true if the setting was applied, false if the mode does not support it
+     *
+     */
+    bool            set_eager_press(bool enable);
+
+    /**
+     * @brief               Enables auto-repeat events of the internal keypad object (see Keypad::set_auto_repeat())
+     *
+     * @remark              The repeats are stored in the same stream as KeypadEventType::REPEAT events, and can be
+     *                      consumed through KeypadBlocking::pop_event()
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param delay         Time from a press to its first repeat (atleast the long-press threshold of 300 milliseconds)
+     * @param period        Time between the first two repeats
+     * @param minPeriod     Shortest time between two repeats (atmost the period, 0 for a fixed period)
+     *
+     * @return              true if auto-repeat was enabled, false if the timings are out of range
+     *
+     */
+    bool            set_auto_repeat(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                                    std::chrono::milliseconds minPeriod = std::chrono::milliseconds(0));
+
+    /**
+     * @brief               Disables auto-repeat events of the internal keypad object
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void            disable_auto_repeat();
+
+    /**
+     * @brief               Returns a snapshot of the counters of the events that were delivered, delayed or lost
+     *                      (see Keypad::get_counters())
+     *
+     * @remark              In addition to the counters of the internal keypad object, this also counts the unconsumed
+     *                      events that were overwritten because the stream was full
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param countersPtr   Location where the snapshot should be stored
+     *
+     */
+    void            get_counters(keypad_counters *countersPtr) const;
+
+    /**
+     * @brief               Clears all the counters
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void            reset_counters();
+
+    /**
+     * @brief               Checks the number of unconsumed events of all types
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of events that have not been popped yet
+     *
+     */
+    uint32_t    event_available() const;
+
+    /**
+     * @brief               Returns the earliest unconsumed event (of any type) without removing it from the internal
+     *                      buffer
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param eptr          Location of variable where the event should be stored (only used if an event was available)
+     *
+     * @return              true if an event was available to peek, false otherwise
+     *
+     */
+    bool        peek_event(keypad_event *eptr) const;
+
+    /**
+     * @brief               Returns the earliest unconsumed event (of any type) and removes it from the internal buffer
+     *
+     * @attention           This function can be called from ISR context
+     * @attention           It is not safe to call this method from multiple threads concurrently
+     *
+     * @param eptr          Location of variable where the event should be stored (only used if an event was available)
+     *
+     * @return              true if an event was available to pop, false otherwise
+     *
+     */
+    bool        pop_event(keypad_event *eptr);
+
+    /**
+     * @brief               Copies the earliest unconsumed events (of all types) in order without removing them from
+     *                      the internal buffer
+     *
+     * @remark              All the events are copied within a single critical section
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param out           Location of array where the events should be stored
+     * @param max           Maximum number of events to copy (length of the array)
+     *
+     * @return              Number of events copied
+     *
+     */
+    uint32_t    peek_events(keypad_event *out, uint32_t max) const;
+
+    /**
+     * @brief               Returns the earliest unconsumed events (of all types) in order and removes them from the
+     *                      internal buffer
+     *
+     * @remark              All the events are copied and removed within a single critical section, which is much
+     *                      cheaper than popping a burst of events one at a time
+     *
+     * @attention           This function can be called from ISR context
+     * @attention           It is not safe to call this method from multiple threads concurrently
+     *
+     * @param out           Location of array where the events should be stored
+     * @param max           Maximum number of events to pop (length of the array)
+     *
+     * @return              Number of events popped
+     *
+     */
+    uint32_t    pop_events(keypad_event *out, uint32_t max);
+
     /**
      * @brief               Checks the number of unconsumed button presses
      *
@@ -160,7 +350,7 @@ public:
      * @return              true if a button press was available to pop, false otherwise
      *
      */
-    bool        pop_press();
+    bool        pop_press(uint32_t *rptr = nullptr, uint32_t *cptr = nullptr);
 
     /**
      * @brief               Returns the earliest unconsumed release without removing it from the internal buffer
@@ -187,7 +377,7 @@ public:
      * @return              true if a button release was available to pop, false otherwise
      *
      */
-    bool        pop_release();
+    bool        pop_release(uint32_t *rptr = nullptr, uint32_t *cptr = nullptr);
 
     /**
      * @brief               Returns the earliest unconsumed long-press without removing it from the internal buffer
@@ -214,36 +404,157 @@ public:
      * @return              true if a button long-press was available to pop, false otherwise
      *
      */
-    bool        pop_longpress();
+    bool        pop_longpress(uint32_t *rptr = nullptr, uint32_t *cptr = nullptr);
+
+    /**
+     * @brief               Waits until an unconsumed event (of any type) is available
+     *
+     * @remark              Returns immediately if an unconsumed event is already available
+     * @remark              The calling thread sleeps while waiting, it is woken up by the internal keypad object
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is not safe to call the wait methods from multiple threads concurrently
+     *
+     * @param timeout       Maximum duration of time to wait for
+     *
+     * @return              true if an event is available, false if the timeout elapsed first
+     *
+     */
+    bool        wait_any(Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
+
+    /**
+     * @brief               Waits until an unconsumed press is available
+     *
+     * @remark              Returns immediately if an unconsumed press is already available
+     * @remark              The calling thread sleeps while waiting, it is woken up by the internal keypad object
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is not safe to call the wait methods from multiple threads concurrently
+     *
+     * @param timeout       Maximum duration of time to wait for
+     *
+     * @return              true if a press is available, false if the timeout elapsed first
+     *
+     */
+    bool        wait_press(Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
+
+    /**
+     * @brief               Waits until an unconsumed release is available
+     *
+     * @remark              Returns immediately if an unconsumed release is already available
+     * @remark              The calling thread sleeps while waiting, it is woken up by the internal keypad object
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is not safe to call the wait methods from multiple threads concurrently
+     *
+     * @param timeout       Maximum duration of time to wait for
+     *
+     * @return              true if a release is available, false if the timeout elapsed first
+     *
+     */
+    bool        wait_release(Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
+
+    /**
+     * @brief               Waits until an unconsumed long-press is available
+     *
+     * @remark              Returns immediately if an unconsumed long-press is already available
+     * @remark              The calling thread sleeps while waiting, it is woken up by the internal keypad object
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is not safe to call the wait methods from multiple threads concurrently
+     *
+     * @param timeout       Maximum duration of time to wait for
+     *
+     * @return              true if a long-press is available, false if the timeout elapsed first
+     *
+     */
+    bool        wait_longpress(Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
 
 private:
 
     /**
-     * @brief               Adds presses to the internal buffer (used as a callback by the internal keypad object)
+     * @brief               Registers the callback through which the internal keypad object fills the internal buffer
+     *
+     */
+    void        register_callbacks();
+
+    /**
+     * @brief               Adds an event to the internal buffer, overwriting the oldest entry if it is full (used as a
+     *                      callback by the internal keypad object)
+     *
+     * @param e             Event to add
+     *
+     */
+    void        push_event(keypad_event e);
+
+    /**
+     * @brief               Finds the earliest unconsumed event of a type
+     *
+     * @attention           Must be called from within a critical section
+     *
+     * @param type          Type of the event
+     *
+     * @return              Offset of the event from the head if one was found, BufLen otherwise
+     *
+     */
+    uint32_t    find_event(KeypadEventType type) const;
+
+    /**
+     * @brief               Returns the earliest unconsumed event of a type without removing it from the internal buffer
      *
-     * @param r             Row of the button that was pressed
-     * @param c             Column of the button that was released
+     * @param type          Type of the event
+     * @param rptr          Location of variable where the row should be stored (only used if an event was available)
+     * @param cptr          Location of variable where the column should be stored (only used if an event was available)
+     *
+     * @return              true if an event of the type was available to peek, false otherwise
      *
      */
-    void        push_press(uint32_t r, uint32_t c);
+    bool        peek_type(KeypadEventType type, uint32_t *rptr, uint32_t *cptr) const;
 
     /**
-     * @brief               Adds releases to the internal buffer (used as a callback by the internal keypad object)
+     * @brief               Removes the earliest unconsumed event of a type from the internal buffer
+     *
+     * @param type          Type of the event
+     * @param rptr          Location of variable where the row should be stored (only used if not nullptr and an event
+     *                      was available)
+     * @param cptr          Location of variable where the column should be stored (only used if not nullptr and an
+     *                      event was available)
      *
-     * @param r             Row of the button that was released
-     * @param c             Column of the button that was released
+     * @return              true if an event of the type was available to pop, false otherwise
      *
      */
-    void        push_release(uint32_t r, uint32_t c);
+    bool        pop_type(KeypadEventType type, uint32_t *rptr, uint32_t *cptr);
 
     /**
-     * @brief               Adds long-presses to the internal buffer (used as a callback by the internal keypad object)
+     * @brief               Waits until an unconsumed event of one of the selected types is available
+     *
+     * @param mask          Flags of the types of events to wait for (bit t is set for type t)
+     * @param timeout       Maximum duration of time to wait for
      *
-     * @param r             Row of the button that was long-pressed
-     * @param c             Column of the button that was long-pressed
+     * @return              true if an event of one of the types is available, false if the timeout elapsed first
      *
      */
-    void        push_longpress(uint32_t r, uint32_t c);
+    bool        wait_flags(uint32_t mask, Kernel::Clock::duration_u32 timeout);
+
+    /**
+     * @brief               Checks the number of unconsumed events of the selected types
+     *
+     * @param mask          Flags of the types of events to count (bit t is set for type t)
+     *
+     * @return              Number of unconsumed events of the types
+     *
+     */
+    uint32_t    available_of(uint32_t mask) const;
+
+    /**
+     * @brief               Drops the entries at the head of the stream which have already been consumed
+     *
+     * @attention           Must be called from within a critical section
+     *
+     */
+    void        drop_consumed();
 };
 
+#include "keypadBlocking.tpp"
+
 #endif //__KEYPADBLOCKING_H__
@@ -0,0 +1,440 @@
+/**
+ * @file                    keypadBlocking.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the KeypadBlocking class template (included by keypadBlocking.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+// Constructors
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::KeypadBlocking(const PinName (&rowPins)[NumRows],
+                                                             const PinName (&colPins)[NumCols], KeypadMode mode)
+        : keypad(rowPins, colPins, mode)
+{
+    register_callbacks();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::KeypadBlocking(PortName rowPort, PortName colPort,
+                                                             const PinName (&rowPins)[NumRows],
+                                                             const PinName (&colPins)[NumCols], KeypadMode mode)
+        : keypad(rowPort, colPort, rowPins, colPins, mode)
+{
+    register_callbacks();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::KeypadBlocking(EventQueue &queue,
+                                                             const PinName (&rowPins)[NumRows],
+                                                             const PinName (&colPins)[NumCols], KeypadMode mode)
+        : keypad(queue, rowPins, colPins, mode)
+{
+    register_callbacks();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::KeypadBlocking(EventQueue &queue, PortName rowPort, PortName colPort,
+                                                             const PinName (&rowPins)[NumRows],
+                                                             const PinName (&colPins)[NumCols], KeypadMode mode)
+        : keypad(queue, rowPort, colPort, rowPins, colPins, mode)
+{
+    register_callbacks();
+}
+
+// Public Methods
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::initialize() {
+    return keypad.initialize();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::finalize() {
+    return keypad.finalize();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::is_initialized() const {
+    return keypad.is_initialized();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::set_eager_press(bool enable) {
+    return keypad.set_eager_press(enable);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::set_auto_repeat(std::chrono::milliseconds delay,
+                                                              std::chrono::milliseconds period,
+                                                              std::chrono::milliseconds minPeriod) {
+    return keypad.set_auto_repeat(delay, period, minPeriod);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::disable_auto_repeat() {
+    keypad.disable_auto_repeat();
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::get_counters(keypad_counters *countersPtr) const {
+
+    keypad.get_counters(countersPtr);
+    countersPtr->overwritten = core_util_atomic_load_u32(&overwritten);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::reset_counters() {
+
+    keypad.reset_counters();
+    core_util_atomic_store_u32(&overwritten, 0);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::event_available() const {
+    return available_of((1U << NumTypes) - 1);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_event(keypad_event *eptr) const {
+
+    // consumed entries never remain at the head, so the head is the earliest unconsumed event (if any)
+
+    CriticalSectionLock lock;
+
+    if (count == 0) {
+        return false;
+    }
+
+    *eptr = events[head];
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_event(keypad_event *eptr) {
+
+    CriticalSectionLock lock;
+
+    if (count == 0) {
+        return false;
+    }
+
+    *eptr = events[head];
+    --available[eptr->type];
+
+    head = (head + 1) % BufLen;
+    --count;
+    drop_consumed();
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_events(keypad_event *out, uint32_t max) const {
+
+    // entries in the middle of the stream may have been consumed by the per-type methods, and are skipped
+
+    CriticalSectionLock lock;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count && n < max; ++i) {
+
+        const auto &e = events[(head + i) % BufLen];
+        if (e.type != ConsumedType) {
+            out[n++] = e;
+        }
+    }
+
+    return n;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_events(keypad_event *out, uint32_t max) {
+
+    // copy the unconsumed entries from the head onwards, then drop everything walked over (including any consumed
+    // entries in between) by advancing the head once
+
+    CriticalSectionLock lock;
+
+    uint32_t n = 0;
+    uint32_t i = 0;
+    for (; i < count && n < max; ++i) {
+
+        const auto &e = events[(head + i) % BufLen];
+        if (e.type != ConsumedType) {
+            --available[e.type];
+            out[n++] = e;
+        }
+    }
+
+    head = (head + i) % BufLen;
+    count -= i;
+    drop_consumed();
+
+    return n;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::press_available() const {
+    return core_util_atomic_load_u32(&available[static_cast<uint32_t>(KeypadEventType::PRESS)]);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::release_available() const {
+    return core_util_atomic_load_u32(&available[static_cast<uint32_t>(KeypadEventType::RELEASE)]);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::longpress_available() const {
+    return core_util_atomic_load_u32(&available[static_cast<uint32_t>(KeypadEventType::LONGPRESS)]);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_press(uint32_t *rptr, uint32_t *cptr) const {
+    return peek_type(KeypadEventType::PRESS, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_press(uint32_t *rptr, uint32_t *cptr) {
+    return pop_type(KeypadEventType::PRESS, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_release(uint32_t *rptr, uint32_t *cptr) const {
+    return peek_type(KeypadEventType::RELEASE, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_release(uint32_t *rptr, uint32_t *cptr) {
+    return pop_type(KeypadEventType::RELEASE, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_longpress(uint32_t *rptr, uint32_t *cptr) const {
+    return peek_type(KeypadEventType::LONGPRESS, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_longpress(uint32_t *rptr, uint32_t *cptr) {
+    return pop_type(KeypadEventType::LONGPRESS, rptr, cptr);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::wait_any(Kernel::Clock::duration_u32 timeout) {
+    return wait_flags((1U << NumTypes) - 1, timeout);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::wait_press(Kernel::Clock::duration_u32 timeout) {
+    return wait_flags(1U << static_cast<uint32_t>(KeypadEventType::PRESS), timeout);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::wait_release(Kernel::Clock::duration_u32 timeout) {
+    return wait_flags(1U << static_cast<uint32_t>(KeypadEventType::RELEASE), timeout);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::wait_longpress(Kernel::Clock::duration_u32 timeout) {
+    return wait_flags(1U << static_cast<uint32_t>(KeypadEventType::LONGPRESS), timeout);
+}
+
+// Private Methods
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::register_callbacks() {
+
+    // register the callback that pushes keypad events (with their timestamps) from the internal object to the
+    // internal buffer
+
+    keypad.register_onevent(callback(this, &KeypadBlocking::push_event));
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::push_event(keypad_event e) {
+
+    // a cancelled press that has not been consumed yet is removed as if it never happened
+    // if the stream is full, overwrite the oldest entry (which is never a consumed one)
+
+    CriticalSectionLock lock;
+
+    if (keypad_event_type(e) == KeypadEventType::CANCEL) {
+        for (uint32_t i = count; i-- > 0;) {
+
+            auto &p = events[(head + i) % BufLen];
+            if (keypad_event_type(p) == KeypadEventType::PRESS && p.r == e.r && p.c == e.c) {
+
+                p.type = ConsumedType;
+                --available[static_cast<uint32_t>(KeypadEventType::PRESS)];
+                drop_consumed();
+                return;
+            }
+        }
+    }
+
+    if (count == BufLen) {
+
+        ++overwritten;
+        --available[events[head].type];
+
+        head = (head + 1) % BufLen;
+        --count;
+        drop_consumed();
+    }
+
+    events[(head + count) % BufLen] = e;
+    ++count;
+    ++available[e.type];
+
+    flags.set(1U << e.type);
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::find_event(KeypadEventType type) const {
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (events[(head + i) % BufLen].type == static_cast<uint32_t>(type)) {
+            return i;
+        }
+    }
+
+    return BufLen;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::peek_type(KeypadEventType type, uint32_t *rptr, uint32_t *cptr) const {
+
+    // if no event of the type is in the stream, return false, store the coordinates to the supplied locations otherwise
+
+    CriticalSectionLock lock;
+
+    const auto i = find_event(type);
+    if (i == BufLen) {
+        return false;
+    }
+
+    const auto &e = events[(head + i) % BufLen];
+    *rptr = e.r;
+    *cptr = e.c;
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::pop_type(KeypadEventType type, uint32_t *rptr, uint32_t *cptr) {
+
+    // mark the earliest event of the type as consumed, it is removed from the stream once it reaches the head
+
+    CriticalSectionLock lock;
+
+    const auto i = find_event(type);
+    if (i == BufLen) {
+        return false;
+    }
+
+    auto &e = events[(head + i) % BufLen];
+    if (rptr != nullptr) {
+        *rptr = e.r;
+    }
+    if (cptr != nullptr) {
+        *cptr = e.c;
+    }
+
+    e.type = ConsumedType;
+    --available[static_cast<uint32_t>(type)];
+    drop_consumed();
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+bool
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::wait_flags(uint32_t mask, Kernel::Clock::duration_u32 timeout) {
+
+    // check for an event before sleeping, the flag of any event pushed after the check wakes the thread up right away
+    // flags are not cleared when events are popped, so a stale flag may wake the thread up without an event, in which
+    // case the flag has now been cleared and the thread goes back to sleep for the remaining duration
+
+    const bool forever = (timeout == Kernel::wait_for_u32_forever);
+    const auto deadline = Kernel::Clock::now() + timeout;
+
+    for (;;) {
+
+        if (available_of(mask) != 0) {
+            return true;
+        }
+
+        auto remaining = Kernel::wait_for_u32_forever;
+        if (!forever) {
+
+            const auto now = Kernel::Clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            remaining = std::chrono::duration_cast<Kernel::Clock::duration_u32>(deadline - now);
+        }
+
+        if (flags.wait_any_for(mask, remaining) & osFlagsError) {
+            return available_of(mask) != 0;
+        }
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+uint32_t
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::available_of(uint32_t mask) const {
+
+    CriticalSectionLock lock;
+
+    uint32_t total = 0;
+    for (uint32_t t = 0; t < NumTypes; ++t) {
+        if (mask & (1U << t)) {
+            total += available[t];
+        }
+    }
+
+    return total;
+}
+
+template <uint32_t NumRows, uint32_t NumCols, template <uint32_t, uint32_t> class IO, uint32_t BufLen>
+void
+KeypadBlocking<NumRows, NumCols, IO, BufLen>::drop_consumed() {
+
+    while (count != 0 && events[head].type == ConsumedType) {
+        head = (head + 1) % BufLen;
+        --count;
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file                    keypadCallback.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Callback slot that can be replaced from any context while it is being called
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADCALLBACK_H__
+#define __KEYPADCALLBACK_H__
+
+#include "mbed.h"
+
+template <typename Signature>
+class KeypadCallback;
+
+/**
+ * @brief                   Double-buffered callback slot, which is replaced without locks, and without tearing down the
+ *                          thread that calls it
+ *
+ * @remark                  The slot holds two callbacks and a single state word, which holds the index of the active
+ *                          callback, whether a callback is attached, whether a replacement is in progress, and the number
+ *                          of callers of each of the two callbacks, all of which are updated by compare-and-swap
+ * @remark                  A replacement writes the inactive callback and then flips the index, so a caller only ever
+ *                          sees a fully written callback, and a callback that is being called is never overwritten (the
+ *                          replacement after next fails instead, until its callers return)
+ *
+ * @attention               At most 255 callers may call the same callback at once (such as nested ISRs)
+ *
+ * @tparam Args             Types of the arguments of the callback
+ */
+template <typename... Args>
+class KeypadCallback<void(Args...)> {
+
+    /** Bit of the state that holds the index of the active callback */
+    static constexpr uint32_t ActiveBit = 1U << 0;
+    /** Bit of the state that is set while a callback is attached */
+    static constexpr uint32_t AttachedBit = 1U << 1;
+    /** Bit of the state that is set while the inactive callback is being written */
+    static constexpr uint32_t WritingBit = 1U << 2;
+    /** Position of the number of callers of the first callback in the state (the second follows it) */
+    static constexpr uint32_t CallersShift = 8;
+
+    /** The two callbacks */
+    Callback<void(Args...)> slots[2];
+    /** Index of the active callback, flags, and the number of callers of each callback */
+    volatile uint32_t   state {0};
+
+public:
+
+    /**
+     * @brief               Replaces the callback
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback function
+     *
+     * @return              true if the callback was replaced, false if another replacement is in progress, or the
+     *                      callback replaced by the previous replacement is still being called (the replacement can be
+     *                      retried once it returns)
+     *
+     */
+    bool        attach(Callback<void(Args...)> cb);
+
+    /**
+     * @brief               Detaches the callback, so that it is not called anymore
+     *
+     * @remark              A call that already started still runs to completion
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        detach();
+
+    /**
+     * @brief               Checks if a callback is attached
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if a callback is attached, false otherwise
+     *
+     */
+    bool        is_attached() const;
+
+    /**
+     * @brief               Calls the callback, if one is attached
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param args          Arguments of the callback
+     *
+     * @return              true if the callback was called, false if none is attached
+     *
+     */
+    bool        call(Args... args);
+};
+
+#include "keypadCallback.tpp"
+
+#endif //__KEYPADCALLBACK_H__
@@ -0,0 +1,75 @@
+/**
+ * @file                    keypadCallback.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the KeypadCallback class template (included by keypadCallback.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+template <typename... Args>
+bool
+KeypadCallback<void(Args...)>::attach(Callback<void(Args...)> cb) {
+
+    // claim the inactive callback, which is only possible if nobody is still calling it
+    // a caller can not start calling it once it is claimed, since callers only call the active one
+    // publish it by flipping the index (the numbers of callers may change in the meantime, so retry until it sticks)
+
+    uint32_t cur = core_util_atomic_load_u32(&state);
+    uint32_t next;
+
+    do {
+        const uint32_t target = (cur & ActiveBit) ^ 1;
+
+        if ((cur & WritingBit) || ((cur >> (CallersShift + 8 * target)) & 0xFF) != 0) {
+            return false;
+        }
+        next = cur | WritingBit;
+    } while (!core_util_atomic_cas_u32(&state, &cur, next));
+
+    const uint32_t target = (next & ActiveBit) ^ 1;
+    slots[target] = std::move(cb);
+
+    cur = core_util_atomic_load_u32(&state);
+    do {
+        next = (cur & ~(ActiveBit | WritingBit)) | target | AttachedBit;
+    } while (!core_util_atomic_cas_u32(&state, &cur, next));
+
+    return true;
+}
+
+template <typename... Args>
+void
+KeypadCallback<void(Args...)>::detach() {
+    core_util_atomic_fetch_and_u32(&state, ~AttachedBit);
+}
+
+template <typename... Args>
+bool
+KeypadCallback<void(Args...)>::is_attached() const {
+    return (core_util_atomic_load_u32(&state) & AttachedBit) != 0;
+}
+
+template <typename... Args>
+bool
+KeypadCallback<void(Args...)>::call(Args... args) {
+
+    // count the caller on the active callback in the same step that reads the index, so that a replacement can not
+    // claim the callback between the two
+
+    uint32_t cur = core_util_atomic_load_u32(&state);
+    uint32_t index;
+
+    do {
+        if (!(cur & AttachedBit)) {
+            return false;
+        }
+        index = cur & ActiveBit;
+    } while (!core_util_atomic_cas_u32(&state, &cur, cur + (1U << (CallersShift + 8 * index))));
+
+    slots[index](args...);
+
+    core_util_atomic_decr_u32(&state, 1U << (CallersShift + 8 * index));
+    return true;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file                    keypadDispatcher.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Statically allocated thread and event queue to dispatch the callbacks of keypads on
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADDISPATCHER_H__
+#define __KEYPADDISPATCHER_H__
+
+#include "mbed.h"
+
+/** Default size (in bytes) of the stack of a KeypadDispatcher's thread */
+constexpr uint32_t  KEYPAD_DISPATCH_STACK_SIZE  = 1024;
+/** Default number of keypads that can share a KeypadDispatcher */
+constexpr uint32_t  KEYPAD_DISPATCH_NUM_KEYPADS = 1;
+/** Number of calls of each keypad that can be pending on a queue at once (the call to drain the ring, and the next
+    one, which is posted while the previous one is still being dispatched) */
+constexpr uint32_t  KEYPAD_DISPATCH_CALLS       = 2;
+
+/**
+ * @brief                   Size (in bytes) of the event queue buffer needed to dispatch the callbacks of a number of
+ *                          keypads
+ *
+ * @remark                  Each keypad has atmost one call pending on its queue at a time, but the queue only frees a
+ *                          call once it returns, so the call posted while the previous one is draining the ring (by an
+ *                          event, the expiry of a KeypadSequence, or a KeypadRecorder that fills up) needs a spare slot
+ *
+ * @param numKeypads        Number of keypads that share the queue
+ *
+ * @return                  Size of the buffer
+ *
+ */
+constexpr uint32_t
+keypad_dispatch_queue_size(uint32_t numKeypads) {
+    return numKeypads * KEYPAD_DISPATCH_CALLS * EVENTS_EVENT_SIZE;
+}
+
+/**
+ * @brief                   Thread and event queue whose stack and buffer live inside the object, so that keypads can
+ *                          dispatch their callbacks without allocating any memory on the heap
+ *
+ * @remark                  The keypads must be constructed on the queue of the dispatcher (see KeypadDispatcher::queue())
+ *                          and are then initialized and finalized independently of the dispatcher
+ * @remark                  Declaring the dispatcher as a global object makes the entire memory footprint known at link
+ *                          time
+ *
+ * @tparam StackSize        Size (in bytes) of the stack of the thread (must be a multiple of 8)
+ * @tparam NumKeypads       Maximum number of keypads that dispatch their callbacks on the object
+ */
+template <uint32_t StackSize = KEYPAD_DISPATCH_STACK_SIZE, uint32_t NumKeypads = KEYPAD_DISPATCH_NUM_KEYPADS>
+class KeypadDispatcher {
+
+    static_assert(StackSize % 8 == 0, "Stack size of the KeypadDispatcher must be a multiple of 8!");
+    static_assert(NumKeypads > 0, "KeypadDispatcher must be able to dispatch atleast one keypad!");
+
+public:
+
+    /** Size (in bytes) of the stack of the thread */
+    static constexpr uint32_t   STACK_SIZE = StackSize;
+    /** Size (in bytes) of the buffer of the event queue */
+    static constexpr uint32_t   QUEUE_SIZE = keypad_dispatch_queue_size(NumKeypads);
+
+private:
+
+    /** Memory used as the stack of the thread */
+    MBED_ALIGN(8) unsigned char stack[STACK_SIZE];
+    /** Memory used as the buffer of the event queue */
+    MBED_ALIGN(8) unsigned char queueBuffer[QUEUE_SIZE];
+
+    /** Memory in which the thread is constructed (a thread can not be restarted, so it is re-constructed on each start) */
+    alignas(Thread) unsigned char threadStorage[sizeof(Thread)];
+    /** Thread used to dispatch the queue (nullptr while not running) */
+    Thread              *threadHandle {nullptr};
+
+    /** Priority of the thread */
+    const osPriority    priority;
+
+    /** Event Queue on which the callbacks of the keypads are called */
+    EventQueue          eventQueue {QUEUE_SIZE, queueBuffer};
+
+public:
+
+    /**
+     * @brief               Construct a new dispatcher object
+     *
+     * @param threadPrio    Priority of the thread that dispatches the callbacks
+     *
+     */
+    explicit KeypadDispatcher(osPriority threadPrio = osPriorityNormal);
+
+    /**
+     * @brief               Destroy the dispatcher object, stopping the thread that dispatches the queue
+     *
+     * @attention           Every keypad constructed on the queue of the dispatcher must be destroyed first
+     *
+     */
+    ~KeypadDispatcher();
+
+    KeypadDispatcher(const KeypadDispatcher &) = delete;
+    KeypadDispatcher &operator=(const KeypadDispatcher &) = delete;
+
+    /**
+     * @brief               Starts the thread that dispatches the queue
+     *
+     * @remark              If the thread was already started, then the KeypadDispatcher::stop() method must be called
+     *                      before trying to restart it
+     * @remark              No memory is allocated on the heap
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is unsafe to call this method from multiple threads concurrently
+     *
+     * @return              true if the thread was successfully started, false otherwise
+     *
+     */
+    bool        start();
+
+    /**
+     * @brief               Stops the thread that dispatches the queue
+     *
+     * @remark              Calls that are pending on the queue are preserved, and dispatched once the thread is started
+     *                      again
+     *
+     * @attention           Can not call this method from ISR context
+     * @attention           It is unsafe to call this method from multiple threads concurrently
+     *
+     * @return              true if the thread was successfully stopped, false otherwise
+     *
+     */
+    bool        stop();
+
+    /**
+     * @brief               Checks if the thread that dispatches the queue is running
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if the thread is running, false otherwise
+     *
+     */
+    bool        is_running() const;
+
+    /**
+     * @brief               Returns the queue on which keypads should be constructed to dispatch their callbacks on the
+     *                      object
+     *
+     * @return              Event Queue of the object
+     *
+     */
+    EventQueue  &queue();
+};
+
+#include "keypadDispatcher.tpp"
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file                    keypadDispatcher.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the KeypadDispatcher class template (included by keypadDispatcher.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#include <new>
+
+// Constructors
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+KeypadDispatcher<StackSize, NumKeypads>::KeypadDispatcher(osPriority threadPrio)
+        : priority(threadPrio)
+{
+}
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+KeypadDispatcher<StackSize, NumKeypads>::~KeypadDispatcher() {
+    stop();
+}
+
+// Public Methods
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+bool
+KeypadDispatcher<StackSize, NumKeypads>::start() {
+
+    // return if the thread is already running; move forward otherwise
+    // construct the thread on the object's own stack and try to start it, return if successful
+    // in case of failure, destroy the thread and return
+
+    if (is_running()) {
+        return false;
+    }
+
+    auto *thread = new (threadStorage) Thread(priority, STACK_SIZE, stack, "keypad_dispatch");
+    auto status = thread->start(callback(&eventQueue, &EventQueue::dispatch_forever));
+
+    if (status != osOK) {
+
+        thread->~Thread();
+        return false;
+    }
+
+    threadHandle = thread;
+    return true;
+}
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+bool
+KeypadDispatcher<StackSize, NumKeypads>::stop() {
+
+    // return if the thread is not running; move forward otherwise
+    // break the queues dispatch, wait for the thread to terminate and destroy it
+
+    if (!is_running()) {
+        return false;
+    }
+
+    eventQueue.break_dispatch();
+    threadHandle->join();
+
+    threadHandle->~Thread();
+    threadHandle = nullptr;
+    return true;
+}
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+bool
+KeypadDispatcher<StackSize, NumKeypads>::is_running() const {
+    return threadHandle != nullptr;
+}
+
+template <uint32_t StackSize, uint32_t NumKeypads>
+EventQueue &
+KeypadDispatcher<StackSize, NumKeypads>::queue() {
+    return eventQueue;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file                    keypadEvents.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Packed keypad events and the lock-free ring used to pass them out of ISR context
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADEVENTS_H__
+#define __KEYPADEVENTS_H__
+
+#include "mbed.h"
+
+/**
+ * @brief                   Enumeration of the types of events generated by a keypad
+ *
+ */
+enum class KeypadEventType : uint8_t {
+
+    /** A button was pressed */
+    PRESS,
+    /** A button was released */
+    RELEASE,
+    /** A button was held down beyond the long-press threshold */
+    LONGPRESS,
+    /** A press that was reported eagerly turned out to be noise (see Keypad::set_eager_press()) */
+    CANCEL,
+    /** A button is still held down after a long-press, and auto-repeat is enabled (see Keypad::set_auto_repeat()) */
+    REPEAT
+};
+
+/** Number of types of events generated by a keypad */
+constexpr uint32_t  KEYPAD_NUM_EVENT_TYPES  = static_cast<uint32_t>(KeypadEventType::REPEAT) + 1;
+/** Number of bits used to store the type of an event */
+constexpr uint32_t  KEYPAD_EVENT_TYPE_BITS  = 4;
+
+static_assert(KEYPAD_NUM_EVENT_TYPES < (1U << KEYPAD_EVENT_TYPE_BITS),
+              "The type field of keypad events must leave atleast one value unused!");
+
+/**
+ * @brief                   Structure to encapsulate a single keypad event, packed into 32 bits
+ *
+ */
+struct keypad_event {
+
+    /** Type of the event (see KeypadEventType) */
+    uint32_t type  : KEYPAD_EVENT_TYPE_BITS;
+    /** Row of the button */
+    uint32_t r     : 5;
+    /** Column of the button */
+    uint32_t c     : 5;
+    /** Whether this is the first KeypadEventType::REPEAT event of the button being held down (0 for other types) */
+    uint32_t first : 1;
+    /** Reserved (always 0) */
+    uint32_t       : 1;
+    /** Time at which the event was generated (in milliseconds, wraps around every 65.536 seconds) */
+    uint32_t time  : 16;
+};
+
+static_assert(sizeof(keypad_event) == 4, "Keypad events must be packed into 32 bits!");
+
+/**
+ * @brief                   Returns the type of an event
+ *
+ * @param e                 Event
+ *
+ * @return                  Type of the event
+ *
+ */
+constexpr KeypadEventType keypad_event_type(const keypad_event &e) {
+    return static_cast<KeypadEventType>(e.type);
+}
+
+/**
+ * @brief                   Lock-free ring of keypad events with a single producer and a single consumer
+ *
+ * @remark                  The producer only writes the tail and the consumer only writes the head, so neither side
+ *                          needs a critical section or any allocation
+ * @remark                  The indices run freely and wrap around naturally, as the length is a power of 2
+ *
+ * @attention               Pushing must only be done from a single context (such as the ISRs of a single keypad, which
+ *                          run on the same ticker) and popping must only be done from a single thread
+ *
+ * @tparam Len              Maximum number of events in the ring (must be a power of 2)
+ * @tparam T                Type of the entries in the ring
+ */
+template <uint32_t Len, typename T = keypad_event>
+class KeypadEventRing {
+
+    static_assert(Len > 0 && (Len & (Len - 1)) == 0, "Length of the event ring must be a power of 2!");
+
+    /** Storage for the events */
+    T                   buf[Len] {};
+
+    /** Number of events popped so far (only written by the consumer) */
+    volatile uint32_t   head {0};
+    /** Number of events pushed so far (only written by the producer) */
+    volatile uint32_t   tail {0};
+
+public:
+
+    /**
+     * @brief               Adds an event to the ring
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param e             Event to add
+     *
+     * @return              true if the event was added, false if the ring was full (the event is dropped)
+     *
+     */
+    bool        push(const T &e);
+
+    /**
+     * @brief               Removes the earliest event from the ring
+     *
+     * @param e             Location where the event should be stored (only used if an event was available)
+     *
+     * @return              true if an event was available, false otherwise
+     *
+     */
+    bool        pop(T &e);
+
+    /**
+     * @brief               Removes as many events as are available (upto a limit) from the ring in order
+     *
+     * @param out           Location where the events should be stored
+     * @param max           Maximum number of events to remove
+     *
+     * @return              Number of events that were removed
+     *
+     */
+    uint32_t    pop(T *out, uint32_t max);
+
+    /**
+     * @brief               Checks the number of events in the ring
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of events that have been pushed but not popped yet
+     *
+     */
+    uint32_t    size() const;
+};
+
+#include "keypadEvents.tpp"
+
+#endif //__KEYPADEVENTS_H__
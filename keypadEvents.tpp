@@ -0,0 +1,61 @@
+/**
+ * @file                    keypadEvents.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the KeypadEventRing class template (included by keypadEvents.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+template <uint32_t Len, typename T>
+bool
+KeypadEventRing<Len, T>::push(const T &e) {
+
+    // the consumer may free up space concurrently, in the worst case the ring looks fuller than it is
+    // the event must be written before the tail is published, which the atomic store orders
+
+    const auto t = tail;
+
+    if (t - core_util_atomic_load_u32(&head) >= Len) {
+        return false;
+    }
+
+    buf[t % Len] = e;
+    core_util_atomic_store_u32(&tail, t + 1);
+    return true;
+}
+
+template <uint32_t Len, typename T>
+bool
+KeypadEventRing<Len, T>::pop(T &e) {
+    return pop(&e, 1) == 1;
+}
+
+template <uint32_t Len, typename T>
+uint32_t
+KeypadEventRing<Len, T>::pop(T *out, uint32_t max) {
+
+    // the producer may add events concurrently, in the worst case they are picked up by the next call
+    // the events must be read before the head is published, which the atomic store orders
+
+    const auto h = head;
+    auto n = core_util_atomic_load_u32(&tail) - h;
+
+    if (n > max) {
+        n = max;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = buf[(h + i) % Len];
+    }
+
+    core_util_atomic_store_u32(&head, h + n);
+    return n;
+}
+
+template <uint32_t Len, typename T>
+uint32_t
+KeypadEventRing<Len, T>::size() const {
+    return core_util_atomic_load_u32(&tail) - core_util_atomic_load_u32(&head);
+}
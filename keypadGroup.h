@@ -0,0 +1,307 @@
+/**
+ * @file                    keypadGroup.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Multiple keypads whose rows are connected to the same pins, scanned together
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADGROUP_H__
+#define __KEYPADGROUP_H__
+
+#include "keypad.h"
+
+/** Maximum number of keypads that can be members of a group */
+constexpr uint32_t  KEYPAD_GROUP_MAX_MEMBERS    = 4;
+
+/**
+ * @brief                   Class that owns the row pins shared by multiple keypads, and scans all of them in one pass
+ *
+ * @remark                  Each member only owns its own columns (through the KeypadGroupIO backend) and tracks its own
+ *                          buttons and callbacks, while the group drives the rows and scans the matrix on a single
+ *                          ticker, reading the columns of every member while a row is driven (so every row is driven
+ *                          once per scan, irrespective of the number of members)
+ * @remark                  The callbacks of every member are dispatched by a single thread owned by the group, so that
+ *                          adding a member does not add a thread or a queue
+ * @remark                  The members always use the KeypadMode::PERIODIC_SCAN mode, since the edge driven modes scan
+ *                          the rows on their own, which raises edges on the columns of the other members
+ * @remark                  Usage -
+ *                          KeypadGroup<4> group(rowPins);
+ *                          Keypad<4, 4, KeypadGroupIO> left(group, leftColPins), right(group, rightColPins);
+ *                          group.initialize(); left.initialize(); right.initialize();
+ *
+ * @tparam NumRows          Number of rows shared by the members
+ */
+template <uint32_t NumRows>
+class KeypadGroup {
+
+    static_assert(NumRows > 0, "Keypad group must have atleast one row!");
+    static_assert(NumRows <= 32, "Keypad group can not have more than 32 rows!");
+
+    template <uint32_t, uint32_t>
+    friend class KeypadGroupIO;
+
+    /** Bitmask with the bit of every row set */
+    static constexpr uint32_t AllRows = (NumRows == 32) ? ~0U : ((1U << NumRows) - 1);
+
+    /** Pins connected to the shared rows */
+    DigitalOut          row[NumRows];
+    /** Bitmask of the rows that are currently driven low */
+    uint32_t            drivenRows {AllRows};
+
+    /** Ticker that scans the matrix of every member */
+    KeypadScanTicker    scanTicker;
+
+    /** Event Queue on which the callbacks of every member are dispatched */
+    EventQueue          queue;
+    /** Thread that dispatches the queue (nullptr while not initialized) */
+    Thread              *threadHandle {nullptr};
+
+    /** Scan handler of each member (see Keypad::group_scan_handler()), empty slots are not scanned */
+    Callback<bool(uint32_t)> members[KEYPAD_GROUP_MAX_MEMBERS];
+
+public:
+
+    KeypadGroup() = delete;
+
+    /**
+     * @brief               Construct a new group, with all rows active
+     *
+     * @param rowPins       Microcontroller Pins to which the shared Row Pins are connected (in order)
+     *
+     */
+    explicit KeypadGroup(const PinName (&rowPins)[NumRows]);
+
+    /**
+     * @brief               Destroy the group, stopping the scans and the dispatch thread
+     *
+     * @attention           Every member must be destroyed before the group
+     *
+     */
+    ~KeypadGroup();
+
+    /**
+     * @brief               Starts the dispatch thread and the scans of the members
+     *
+     * @remark              The members must still be initialized on their own (which starts posting their events on the
+     *                      queue of the group), and may be initialized before or after the group
+     *
+     * @return              true if the group was initialized, false if it already was or the thread could not be started
+     *
+     */
+    bool        initialize();
+
+    /**
+     * @brief               Stops the scans of the members and the dispatch thread
+     *
+     * @return              true if the group was finalized, false if it was not initialized
+     *
+     */
+    bool        finalize();
+
+    /**
+     * @brief               Checks if the group was initialized
+     *
+     * @return              true if the group was initialized, false otherwise
+     *
+     */
+    bool        is_initialized() const;
+
+    /**
+     * @brief               Returns the queue on which the callbacks of every member are dispatched
+     *
+     * @return              Event Queue of the group
+     *
+     */
+    EventQueue  &get_queue();
+
+    /**
+     * @brief               Returns the number of keypads that are members of the group
+     *
+     * @remark              A keypad that could not join the group (because KEYPAD_GROUP_MAX_MEMBERS keypads already are
+     *                      members) is never scanned
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of members
+     *
+     */
+    uint32_t    get_num_members() const;
+
+private:
+
+    /**
+     * @brief               Constructs the pin objects by expanding the supplied pin array
+     *
+     * @param rowPins       Microcontroller Pins to which the shared Row Pins are connected (in order)
+     *
+     */
+    template <size_t... Rows>
+    KeypadGroup(const PinName (&rowPins)[NumRows], std::index_sequence<Rows...>);
+
+    /**
+     * @brief               Adds a member to the group
+     *
+     * @param scan          Scan handler of the member
+     *
+     * @return              Slot of the member, -1 if the group is full
+     *
+     */
+    int         join(Callback<bool(uint32_t)> scan);
+
+    /**
+     * @brief               Removes a member from the group
+     *
+     * @param slot          Slot of the member (returned by KeypadGroup::join())
+     *
+     */
+    void        leave(int slot);
+
+    /**
+     * @brief               Drives the selected rows low (active) and all the other rows high (inactive)
+     *
+     * @remark              Only the rows whose level changes are written to
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param rows          Bitmask of the rows to activate (bit r corresponds to row r)
+     *
+     */
+    void        drive(uint32_t rows);
+
+    /**
+     * @brief               Scans the matrix of every member on every tick
+     *
+     * @remark              The rows are only scanned one at a time if any member has an active column, otherwise a tick
+     *                      costs a single read of the columns of each member
+     *
+     */
+    void        scan_handler();
+};
+
+/**
+ * @brief                   Backend of a keypad that is a member of a KeypadGroup, which only owns the columns
+ *
+ * @remark                  The rows are driven by the group, the backend reads the columns and collects them into a
+ *                          frame while the group scans the rows
+ *
+ * @tparam NumRows          Number of rows on the keypad (shared with the group)
+ * @tparam NumCols          Number of columns on the keypad
+ */
+template <uint32_t NumRows, uint32_t NumCols>
+class KeypadGroupIO {
+
+    /** Bitmask with the bit of every column set */
+    static constexpr uint32_t AllCols = (NumCols == 32) ? ~0U : ((1U << NumCols) - 1);
+
+    /** Group that drives the rows */
+    KeypadGroup<NumRows> &group;
+    /** Pins connected to the Keypad's cols (their interrupts are not used) */
+    InterruptIn         col[NumCols];
+
+    /** Slot of the keypad in the group (-1 if it is not a member) */
+    int                 slot {-1};
+    /** Columns that were active while all the rows were driven, during the current scan */
+    uint32_t            activeCols {0};
+    /** Bitmask of held down buttons of each row, collected during the current scan */
+    uint32_t            frame[NumRows] {};
+
+public:
+
+    KeypadGroupIO() = delete;
+
+    /**
+     * @brief               Construct a new backend
+     *
+     * @param owner         Group that drives the rows (must outlive the object)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    KeypadGroupIO(KeypadGroup<NumRows> &owner, const PinName (&colPins)[NumCols]);
+
+    /**
+     * @brief               Destroy the backend, removing the keypad from the group
+     *
+     */
+    ~KeypadGroupIO();
+
+    /**
+     * @brief               Adds the keypad to the group
+     *
+     * @param scan          Scan handler of the keypad (see Keypad::group_scan_handler())
+     *
+     * @return              true if the keypad was added, false if the group is full
+     *
+     */
+    bool        join(Callback<bool(uint32_t)> scan);
+
+    /**
+     * @brief               Returns the interrupt pin of a column
+     *
+     * @param c             Column of the keypad
+     *
+     * @return              Interrupt pin connected to the column
+     *
+     */
+    InterruptIn &column(uint32_t c);
+
+    /**
+     * @brief               Drives the selected rows of the group low (active) and all the other rows high (inactive)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param rows          Bitmask of the rows to activate (bit r corresponds to row r)
+     *
+     */
+    void        drive(uint32_t rows);
+
+    /**
+     * @brief               Reads the selected columns
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cols          Bitmask of the columns to read (bit c corresponds to column c)
+     *
+     * @return              Bitmask of the selected columns that are active (pulled low)
+     *
+     */
+    uint32_t    read(uint32_t cols);
+
+    /**
+     * @brief               Collects the columns while the group drives the rows
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param step          0 while all the rows are driven, r + 1 while only row r is driven
+     *
+     * @return              true if any column is active (only meaningful for step 0)
+     *
+     */
+    bool        scan_step(uint32_t step);
+
+    /**
+     * @brief               Returns the frame collected during the latest scan
+     *
+     * @return              Bitmask of held down buttons of each row
+     *
+     */
+    const uint32_t (&scanned() const)[NumRows];
+
+private:
+
+    /**
+     * @brief               Constructs the pin objects by expanding the supplied pin array
+     *
+     * @param owner         Group that drives the rows (must outlive the object)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    template <size_t... Cols>
+    KeypadGroupIO(KeypadGroup<NumRows> &owner, const PinName (&colPins)[NumCols], std::index_sequence<Cols...>);
+};
+
+#include "keypadGroup.tpp"
+
+#endif //__KEYPADGROUP_H__
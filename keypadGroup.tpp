@@ -0,0 +1,270 @@
+/**
+ * @file                    keypadGroup.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the KeypadGroup and KeypadGroupIO class templates (included by
+ *                          keypadGroup.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+// KeypadGroup
+
+template <uint32_t NumRows>
+KeypadGroup<NumRows>::KeypadGroup(const PinName (&rowPins)[NumRows])
+        : KeypadGroup(rowPins, std::make_index_sequence<NumRows>{})
+{
+}
+
+template <uint32_t NumRows>
+template <size_t... Rows>
+KeypadGroup<NumRows>::KeypadGroup(const PinName (&rowPins)[NumRows], std::index_sequence<Rows...>)
+        : row{{rowPins[Rows], 0}...}
+{
+}
+
+template <uint32_t NumRows>
+KeypadGroup<NumRows>::~KeypadGroup() {
+    finalize();
+}
+
+template <uint32_t NumRows>
+bool
+KeypadGroup<NumRows>::initialize() {
+
+    // start the thread first, so that the events of the first scan can be dispatched right away
+
+    if (is_initialized()) {
+        return false;
+    }
+
+    threadHandle = new (std::nothrow) Thread();
+    if (threadHandle == nullptr) {
+        return false;
+    }
+
+    if (threadHandle->start(callback(&queue, &EventQueue::dispatch_forever)) != osOK) {
+
+        delete threadHandle;
+        threadHandle = nullptr;
+
+        return false;
+    }
+
+    scanTicker.attach(callback(this, &KeypadGroup::scan_handler), MATRIX_SCAN_PERIOD);
+    return true;
+}
+
+template <uint32_t NumRows>
+bool
+KeypadGroup<NumRows>::finalize() {
+
+    if (!is_initialized()) {
+        return false;
+    }
+
+    scanTicker.detach();
+
+    queue.break_dispatch();
+    threadHandle->join();
+
+    delete threadHandle;
+    threadHandle = nullptr;
+
+    return true;
+}
+
+template <uint32_t NumRows>
+bool
+KeypadGroup<NumRows>::is_initialized() const {
+    return threadHandle != nullptr;
+}
+
+template <uint32_t NumRows>
+EventQueue &
+KeypadGroup<NumRows>::get_queue() {
+    return queue;
+}
+
+template <uint32_t NumRows>
+uint32_t
+KeypadGroup<NumRows>::get_num_members() const {
+
+    uint32_t n = 0;
+    for (const auto &m : members) {
+        n += m ? 1 : 0;
+    }
+
+    return n;
+}
+
+template <uint32_t NumRows>
+int
+KeypadGroup<NumRows>::join(Callback<bool(uint32_t)> scan) {
+
+    CriticalSectionLock lock;
+
+    for (uint32_t i = 0; i < KEYPAD_GROUP_MAX_MEMBERS; ++i) {
+        if (!members[i]) {
+
+            members[i] = scan;
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+template <uint32_t NumRows>
+void
+KeypadGroup<NumRows>::leave(int slot) {
+
+    CriticalSectionLock lock;
+    members[slot] = nullptr;
+}
+
+template <uint32_t NumRows>
+void
+KeypadGroup<NumRows>::drive(uint32_t rows) {
+
+    // only write to the rows whose level changes, so that moving from one row to the next costs two writes
+
+    auto changed = rows ^ drivenRows;
+    drivenRows = rows;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        if (changed & (1U << i)) {
+            row[i] = (rows & (1U << i)) ? 0 : 1;
+        }
+    }
+}
+
+template <uint32_t NumRows>
+void
+KeypadGroup<NumRows>::scan_handler() {
+
+    // with all the rows driven low, every member reads its columns, and the rows are only scanned if any of them is
+    // active (the members with no active column skip their reads while the rows are scanned)
+    // every member only processes its frame once all the rows are driven low again, so that its immediate callback
+    // never runs halfway through a scan
+
+    bool active = false;
+    for (auto &m : members) {
+        if (m) {
+            active = m(0) || active;
+        }
+    }
+
+    if (active) {
+
+        for (uint32_t i = 0; i < NumRows; ++i) {
+
+            drive(1U << i);
+            for (auto &m : members) {
+                if (m) {
+                    m(i + 1);
+                }
+            }
+        }
+
+        drive(AllRows);
+    }
+
+    for (auto &m : members) {
+        if (m) {
+            m(NumRows + 1);
+        }
+    }
+}
+
+// KeypadGroupIO
+
+template <uint32_t NumRows, uint32_t NumCols>
+KeypadGroupIO<NumRows, NumCols>::KeypadGroupIO(KeypadGroup<NumRows> &owner, const PinName (&colPins)[NumCols])
+        : KeypadGroupIO(owner, colPins, std::make_index_sequence<NumCols>{})
+{
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+template <size_t... Cols>
+KeypadGroupIO<NumRows, NumCols>::KeypadGroupIO(KeypadGroup<NumRows> &owner, const PinName (&colPins)[NumCols],
+                                               std::index_sequence<Cols...>)
+        : group(owner)
+        , col{{colPins[Cols]}...}
+{
+    for (auto &e : col) {
+        e.mode(PullUp);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+KeypadGroupIO<NumRows, NumCols>::~KeypadGroupIO() {
+
+    if (slot >= 0) {
+        group.leave(slot);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+bool
+KeypadGroupIO<NumRows, NumCols>::join(Callback<bool(uint32_t)> scan) {
+
+    slot = group.join(scan);
+    return slot >= 0;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+InterruptIn &
+KeypadGroupIO<NumRows, NumCols>::column(uint32_t c) {
+    return col[c];
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+void
+KeypadGroupIO<NumRows, NumCols>::drive(uint32_t rows) {
+    group.drive(rows);
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadGroupIO<NumRows, NumCols>::read(uint32_t cols) {
+
+    uint32_t active = 0;
+    for (uint32_t c = 0; c < NumCols; ++c) {
+        if ((cols & (1U << c)) && !col[c].read()) {
+            active |= (1U << c);
+        }
+    }
+
+    return active;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+bool
+KeypadGroupIO<NumRows, NumCols>::scan_step(uint32_t step) {
+
+    // only the columns that were active while all the rows were driven need to be read while a single row is driven,
+    // the same as Keypad::scan_matrix()
+
+    if (step == 0) {
+
+        activeCols = read(AllCols);
+        for (auto &e : frame) {
+            e = 0;
+        }
+
+        return activeCols != 0;
+    }
+
+    if (activeCols != 0) {
+        frame[step - 1] = read(activeCols);
+    }
+
+    return true;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+const uint32_t (&KeypadGroupIO<NumRows, NumCols>::scanned() const)[NumRows] {
+    return frame;
+}
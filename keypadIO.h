@@ -0,0 +1,380 @@
+/**
+ * @file                    keypadIO.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Backends used by the Keypad to drive the rows and read the columns of the matrix
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADIO_H__
+#define __KEYPADIO_H__
+
+#include "mbed.h"
+
+#include <utility>
+
+/**
+ * @brief                   Backend that drives each row and reads each column through its own pin object
+ *
+ * @remark                  Works with any set of pins, but every row that changes and every column that is read costs
+ *                          a separate HAL call
+ * @remark                  A row is active when it is driven low, a column is active when it is pulled low (by a button
+ *                          on an active row)
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ */
+template <uint32_t NumRows, uint32_t NumCols>
+class KeypadPinIO {
+
+    /** Pins connected to the Keypad's rows */
+    DigitalOut          row[NumRows];
+    /** Pins connected to the Keypad's cols */
+    InterruptIn         col[NumCols];
+
+    /** Bitmask of the rows that are currently driven low */
+    uint32_t            drivenRows;
+
+public:
+
+    KeypadPinIO() = delete;
+
+    /**
+     * @brief               Construct a new backend, with all rows active
+     *
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    KeypadPinIO(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols]);
+
+    /**
+     * @brief               Returns the interrupt pin of a column, on which the edge handlers are registered
+     *
+     * @param c             Column of the keypad
+     *
+     * @return              Interrupt pin connected to the column
+     *
+     */
+    InterruptIn &column(uint32_t c);
+
+    /**
+     * @brief               Drives the selected rows low (active) and all the other rows high (inactive)
+     *
+     * @remark              Only the rows whose level changes are written to
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param rows          Bitmask of the rows to activate (bit r corresponds to row r)
+     *
+     */
+    void        drive(uint32_t rows);
+
+    /**
+     * @brief               Reads the selected columns
+     *
+     * @remark              Only the selected columns are read
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cols          Bitmask of the columns to read (bit c corresponds to column c)
+     *
+     * @return              Bitmask of the selected columns that are active (pulled low)
+     *
+     */
+    uint32_t    read(uint32_t cols);
+
+private:
+
+    /**
+     * @brief               Constructs the pin objects by expanding the supplied pin arrays
+     *
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    template <size_t... Rows, size_t... Cols>
+    KeypadPinIO(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                std::index_sequence<Rows...>, std::index_sequence<Cols...>);
+};
+
+#if DEVICE_PORTIN && DEVICE_PORTOUT
+
+/**
+ * @brief                   Backend that drives all the rows with a single port write and reads all the columns with a
+ *                          single port read
+ *
+ * @remark                  All the rows must be on one GPIO port and all the columns must be on one GPIO port (which
+ *                          may be the same port as the rows), but the pins may be in any order within their port
+ * @remark                  When the pins of the rows (or columns) are consecutive and in order within their port, the
+ *                          conversion between port values and bitmasks reduces to a shift
+ * @remark                  The columns still have their own interrupt pins, which are used to detect edges
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ */
+template <uint32_t NumRows, uint32_t NumCols>
+class KeypadPortIO {
+
+    /** Port to which the Keypad's rows are connected */
+    PortOut             rowPort;
+    /** Port to which the Keypad's cols are connected */
+    PortIn              colPort;
+    /** Pins connected to the Keypad's cols (only used for interrupts) */
+    InterruptIn         col[NumCols];
+
+    /** Position of each row within its port */
+    uint8_t             rowBit[NumRows];
+    /** Position of each column within its port */
+    uint8_t             colBit[NumCols];
+
+    /** Mask of the rows within their port */
+    uint32_t            rowMask {};
+    /** Mask of the columns within their port */
+    uint32_t            colMask {};
+
+    /** Position of row 0 within its port if all the rows are consecutive and in order, -1 otherwise */
+    int8_t              rowShift {-1};
+    /** Position of column 0 within its port if all the columns are consecutive and in order, -1 otherwise */
+    int8_t              colShift {-1};
+
+public:
+
+    KeypadPortIO() = delete;
+
+    /**
+     * @brief               Construct a new backend, with all rows active
+     *
+     * @attention           Every row pin must belong to rowPort and every column pin must belong to colPort
+     *
+     * @param rowPortName   GPIO port to which all the Row Pins of the keypad belong
+     * @param colPortName   GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    KeypadPortIO(PortName rowPortName, PortName colPortName,
+                 const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols]);
+
+    /**
+     * @brief               Returns the interrupt pin of a column, on which the edge handlers are registered
+     *
+     * @param c             Column of the keypad
+     *
+     * @return              Interrupt pin connected to the column
+     *
+     */
+    InterruptIn &column(uint32_t c);
+
+    /**
+     * @brief               Drives the selected rows low (active) and all the other rows high (inactive)
+     *
+     * @remark              Always costs a single port write
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param rows          Bitmask of the rows to activate (bit r corresponds to row r)
+     *
+     */
+    void        drive(uint32_t rows);
+
+    /**
+     * @brief               Reads the selected columns
+     *
+     * @remark              Always costs a single port read
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cols          Bitmask of the columns to read (bit c corresponds to column c)
+     *
+     * @return              Bitmask of the selected columns that are active (pulled low)
+     *
+     */
+    uint32_t    read(uint32_t cols);
+
+    /**
+     * @brief               Returns the value of the row port that activates the selected rows
+     *
+     * @remark              Only the bits of the rows within their port (see KeypadPortIO::get_row_mask()) are
+     *                      meaningful, so that the values can be written to the port by a DMA (see KeypadScanCapture)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param rows          Bitmask of the rows to activate (bit r corresponds to row r)
+     *
+     * @return              Value of the row port, with the bits of the active rows cleared
+     *
+     */
+    uint32_t    row_value(uint32_t rows) const;
+
+    /**
+     * @brief               Converts a value read from the column port into the bitmask of active columns
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param value         Value read from the column port
+     *
+     * @return              Bitmask of the columns that are active (pulled low)
+     *
+     */
+    uint32_t    columns(uint32_t value) const;
+
+    /**
+     * @brief               Returns the mask of the rows within their port
+     *
+     * @return              Mask with the bit of every row within the row port set
+     *
+     */
+    uint32_t    get_row_mask() const;
+
+    /**
+     * @brief               Returns the mask of the columns within their port
+     *
+     * @return              Mask with the bit of every column within the column port set
+     *
+     */
+    uint32_t    get_col_mask() const;
+
+private:
+
+    /**
+     * @brief               Constructs the pin objects by expanding the supplied pin arrays
+     *
+     * @param rowPortName   GPIO port to which all the Row Pins of the keypad belong
+     * @param colPortName   GPIO port to which all the Column Pins of the keypad belong
+     * @param rowPins       Microcontroller Pins to which the Row Pins of the keypad are connected (in order)
+     * @param colPins       Microcontroller Pins to which the Column Pins of the keypad are connected (in order)
+     *
+     */
+    template <size_t... Cols>
+    KeypadPortIO(PortName rowPortName, PortName colPortName,
+                 const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols], std::index_sequence<Cols...>);
+
+    /**
+     * @brief               Finds the position of a pin within its port
+     *
+     * @param port          GPIO port to which the pin belongs
+     * @param pin           Microcontroller Pin
+     *
+     * @return              Position of the pin within the port
+     *
+     */
+    static uint8_t  find_bit(PortName port, PinName pin);
+
+    /**
+     * @brief               Computes the mask of a set of pins within their port
+     *
+     * @param port          GPIO port to which the pins belong
+     * @param pins          Microcontroller Pins
+     * @param n             Number of pins
+     *
+     * @return              Mask with the bit of every pin within the port set
+     *
+     */
+    static uint32_t port_mask(PortName port, const PinName *pins, uint32_t n);
+
+    /**
+     * @brief               Checks if a set of pins is consecutive and in order within their port
+     *
+     * @param bits          Position of each pin within the port
+     * @param n             Number of pins
+     *
+     * @return              Position of the first pin if the pins are consecutive and in order, -1 otherwise
+     *
+     */
+    static int8_t   find_shift(const uint8_t *bits, uint32_t n);
+};
+
+/**
+ * @brief                   Buffers through which a DMA scans a matrix whose rows and columns are on GPIO ports, and
+ *                          which turns the captured port values into scans of the matrix
+ *
+ * @remark                  The DMA is set up by the application (the controllers and their triggers are specific to
+ *                          each target), typically as a timer that triggers two transfers per row - one from
+ *                          KeypadScanCapture::get_row_values() to the output register of the row port, and one from
+ *                          the input register of the column port to KeypadScanCapture::get_samples(), with NumRows
+ *                          transfers per pass
+ * @remark                  Once a pass is complete (such as in the transfer complete interrupt of the DMA), calling
+ *                          KeypadScanCapture::update() compares every sample with the one from the previous pass, and
+ *                          only converts the rows whose columns changed, so that an idle matrix costs one compare per
+ *                          row, after which KeypadScanCapture::get_frame() can be passed to Keypad::process_scan()
+ * @remark                  If the output register is shared with other pins, the DMA must write to a set/reset register
+ *                          instead, with the bits of KeypadPortIO::get_row_mask() set or reset following each value
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ */
+template <uint32_t NumRows, uint32_t NumCols>
+class KeypadScanCapture {
+
+    /** Backend whose pins are scanned */
+    const KeypadPortIO<NumRows, NumCols> &io;
+
+    /** Value of the row port that activates each row (the source of the DMA that drives the rows) */
+    uint32_t            rowValues[NumRows];
+    /** Value of the column port while each row was active (the destination of the DMA that reads the columns) */
+    volatile uint32_t   samples[NumRows];
+    /** Samples of the previous pass */
+    uint32_t            lastSamples[NumRows];
+    /** Bitmask of held down buttons of each row, converted from the samples */
+    uint32_t            frame[NumRows] {};
+
+public:
+
+    KeypadScanCapture() = delete;
+
+    /**
+     * @brief               Construct new buffers for the pins of a backend (see Keypad::get_io())
+     *
+     * @param backend       Backend whose pins are scanned (must outlive the object)
+     *
+     */
+    explicit KeypadScanCapture(const KeypadPortIO<NumRows, NumCols> &backend);
+
+    /**
+     * @brief               Returns the values of the row port that activate each row, in order
+     *
+     * @return              Array of NumRows values
+     *
+     */
+    const uint32_t  *get_row_values() const;
+
+    /**
+     * @brief               Returns the buffer into which the DMA stores the value of the column port while each row is
+     *                      active, in order
+     *
+     * @return              Array of NumRows values
+     *
+     */
+    volatile uint32_t *get_samples();
+
+    /**
+     * @brief               Converts the samples of the latest pass into a scan of the matrix
+     *
+     * @attention           This function can be called from ISR context
+     * @attention           The DMA must not be writing to the samples while they are converted (for example, it must
+     *                      be converted from the transfer complete interrupt, before the next pass is triggered)
+     *
+     * @return              true if any button changed since the previous pass, false otherwise
+     *
+     */
+    bool        update();
+
+    /**
+     * @brief               Returns the scan of the matrix converted from the latest pass
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Bitmask of held down buttons of each row
+     *
+     */
+    const uint32_t (&get_frame() const)[NumRows];
+};
+
+#endif // DEVICE_PORTIN && DEVICE_PORTOUT
+
+#include "keypadIO.tpp"
+
+#endif //__KEYPADIO_H__
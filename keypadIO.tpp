@@ -0,0 +1,289 @@
+/**
+ * @file                    keypadIO.tpp
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Implementation of the Keypad backends (included by keypadIO.h)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+// KeypadPinIO
+
+template <uint32_t NumRows, uint32_t NumCols>
+KeypadPinIO<NumRows, NumCols>::KeypadPinIO(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols])
+        : KeypadPinIO(rowPins, colPins, std::make_index_sequence<NumRows>{}, std::make_index_sequence<NumCols>{})
+{
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+template <size_t... Rows, size_t... Cols>
+KeypadPinIO<NumRows, NumCols>::KeypadPinIO(const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                           std::index_sequence<Rows...>, std::index_sequence<Cols...>)
+        : row{{rowPins[Rows], 0}...}
+        , col{{colPins[Cols]}...}
+        , drivenRows {(NumRows == 32) ? ~0U : ((1U << NumRows) - 1)}
+{
+    // Use the internal pullup resistors for all the interrupt pins (cols) and switch the rows off
+    // whenever a button is pressed, its corresponding column is pulled low, i.e. a fall interrupt happens
+    // whenever a button is lifted, its corresponding column is pulled high, i.e. a rise interrupt happens
+
+    for (auto &e : col) {
+        e.mode(PullUp);
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+InterruptIn &
+KeypadPinIO<NumRows, NumCols>::column(uint32_t c) {
+    return col[c];
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+void
+KeypadPinIO<NumRows, NumCols>::drive(uint32_t rows) {
+
+    // only write to the rows whose level changes, so that moving from one row to the next costs two writes
+
+    auto changed = rows ^ drivenRows;
+    drivenRows = rows;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        if (changed & (1U << i)) {
+            row[i] = (rows & (1U << i)) ? 0 : 1;
+        }
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPinIO<NumRows, NumCols>::read(uint32_t cols) {
+
+    uint32_t active = 0;
+    for (uint32_t c = 0; c < NumCols; ++c) {
+        if ((cols & (1U << c)) && !col[c].read()) {
+            active |= (1U << c);
+        }
+    }
+
+    return active;
+}
+
+#if DEVICE_PORTIN && DEVICE_PORTOUT
+
+// KeypadPortIO
+
+template <uint32_t NumRows, uint32_t NumCols>
+KeypadPortIO<NumRows, NumCols>::KeypadPortIO(PortName rowPortName, PortName colPortName,
+                                             const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols])
+        : KeypadPortIO(rowPortName, colPortName, rowPins, colPins, std::make_index_sequence<NumCols>{})
+{
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+template <size_t... Cols>
+KeypadPortIO<NumRows, NumCols>::KeypadPortIO(PortName rowPortName, PortName colPortName,
+                                             const PinName (&rowPins)[NumRows], const PinName (&colPins)[NumCols],
+                                             std::index_sequence<Cols...>)
+        : rowPort(rowPortName, port_mask(rowPortName, rowPins, NumRows))
+        , colPort(colPortName, port_mask(colPortName, colPins, NumCols))
+        , col{{colPins[Cols]}...}
+{
+    // find where each pin lies within its port, and whether the pins can be converted with a single shift
+    // configuring the port for input may reset the pulls, so the pullups are enabled only after both are constructed
+    // all the rows are driven low (active) to begin with, like the pin backend
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+        rowBit[i] = find_bit(rowPortName, rowPins[i]);
+    }
+    for (uint32_t c = 0; c < NumCols; ++c) {
+        colBit[c] = find_bit(colPortName, colPins[c]);
+    }
+
+    rowMask = port_mask(rowPortName, rowPins, NumRows);
+    colMask = port_mask(colPortName, colPins, NumCols);
+    rowShift = find_shift(rowBit, NumRows);
+    colShift = find_shift(colBit, NumCols);
+
+    colPort.mode(PullUp);
+    for (auto &e : col) {
+        e.mode(PullUp);
+    }
+
+    rowPort.write(0);
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+InterruptIn &
+KeypadPortIO<NumRows, NumCols>::column(uint32_t c) {
+    return col[c];
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+void
+KeypadPortIO<NumRows, NumCols>::drive(uint32_t rows) {
+
+    rowPort.write(row_value(rows));
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::read(uint32_t cols) {
+    return columns(colPort.read()) & cols;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::row_value(uint32_t rows) const {
+
+    // active rows are driven low, so the bits of the active rows are cleared from the port value
+
+    uint32_t active = 0;
+
+    if (rowShift >= 0) {
+        active = rows << rowShift;
+    }
+    else {
+        for (uint32_t i = 0; i < NumRows; ++i) {
+            if (rows & (1U << i)) {
+                active |= (1U << rowBit[i]);
+            }
+        }
+    }
+
+    return rowMask & ~active;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::columns(uint32_t value) const {
+
+    // active columns are pulled low, so the port value is inverted before gathering the bits of the columns
+
+    const uint32_t raw = ~value & colMask;
+
+    if (colShift >= 0) {
+        return raw >> colShift;
+    }
+
+    uint32_t active = 0;
+    for (uint32_t c = 0; c < NumCols; ++c) {
+        if (raw & (1U << colBit[c])) {
+            active |= (1U << c);
+        }
+    }
+
+    return active;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::get_row_mask() const {
+    return rowMask;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::get_col_mask() const {
+    return colMask;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint8_t
+KeypadPortIO<NumRows, NumCols>::find_bit(PortName port, PinName pin) {
+
+    // the HAL knows which pin each bit of the port corresponds to, so search through all of them
+
+    for (uint8_t n = 0; n < 32; ++n) {
+        if (port_pin(port, n) == pin) {
+            return n;
+        }
+    }
+
+    MBED_ASSERT(false);
+    return 0;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+uint32_t
+KeypadPortIO<NumRows, NumCols>::port_mask(PortName port, const PinName *pins, uint32_t n) {
+
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        mask |= (1U << find_bit(port, pins[i]));
+    }
+
+    return mask;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+int8_t
+KeypadPortIO<NumRows, NumCols>::find_shift(const uint8_t *bits, uint32_t n) {
+
+    for (uint32_t i = 1; i < n; ++i) {
+        if (bits[i] != bits[0] + i) {
+            return -1;
+        }
+    }
+
+    return static_cast<int8_t>(bits[0]);
+}
+
+// KeypadScanCapture
+
+template <uint32_t NumRows, uint32_t NumCols>
+KeypadScanCapture<NumRows, NumCols>::KeypadScanCapture(const KeypadPortIO<NumRows, NumCols> &backend)
+        : io(backend)
+{
+    // the previous pass starts out with every column high, which converts to every button being released
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        rowValues[i] = io.row_value(1U << i);
+        samples[i] = ~0U;
+        lastSamples[i] = ~0U;
+    }
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+const uint32_t *
+KeypadScanCapture<NumRows, NumCols>::get_row_values() const {
+    return rowValues;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+volatile uint32_t *
+KeypadScanCapture<NumRows, NumCols>::get_samples() {
+    return samples;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+bool
+KeypadScanCapture<NumRows, NumCols>::update() {
+
+    // only the bits of the columns are compared, the other pins of the column port may change freely
+
+    const auto colMask = io.get_col_mask();
+    bool changed = false;
+
+    for (uint32_t i = 0; i < NumRows; ++i) {
+
+        const uint32_t s = samples[i];
+        if (((s ^ lastSamples[i]) & colMask) == 0) {
+            continue;
+        }
+
+        lastSamples[i] = s;
+        frame[i] = io.columns(s);
+        changed = true;
+    }
+
+    return changed;
+}
+
+template <uint32_t NumRows, uint32_t NumCols>
+const uint32_t (&KeypadScanCapture<NumRows, NumCols>::get_frame() const)[NumRows] {
+    return frame;
+}
+
+#endif // DEVICE_PORTIN && DEVICE_PORTOUT
@@ -0,0 +1,197 @@
+/**
+ * @file                    keypadKeymap.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Compile-time tables to translate the coordinates of buttons into key codes
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADKEYMAP_H__
+#define __KEYPADKEYMAP_H__
+
+#include "mbed.h"
+
+#include "keypadEvents.h"
+
+#include <array>
+
+/**
+ * @brief                   Table of the key code of every button on every layer of a keypad
+ *
+ * @remark                  The table is an aggregate, so declaring it as a constexpr (or static const) object places it
+ *                          in flash, and translating a button is a single indexed load
+ * @remark                  Layers are numbered from 0, and the layer to use is chosen by the caller (so that any button
+ *                          may act as a layer switch), except for long-presses and the repeats that follow them, which
+ *                          use the shift layer if one is set (a long-press acts as holding shift for the button)
+ * @remark                  To receive the key codes instead of the coordinates, register a KeypadKeymapTranslator as the
+ *                          callback for every event
+ * @remark                  The codes of each layer are listed row by row, for example -
+ *                          constexpr KeypadKeymap<2, 2, 2> keymap {{{'1', '2', '3', '4', 'a', 'b', 'c', 'd'}}, 1};
+ *
+ * @tparam NumRows          Number of rows on the keypad
+ * @tparam NumCols          Number of columns on the keypad
+ * @tparam NumLayers        Number of layers in the table
+ * @tparam Code             Type of the key codes
+ */
+template <uint32_t NumRows, uint32_t NumCols, uint32_t NumLayers = 1, typename Code = char>
+struct KeypadKeymap {
+
+    static_assert(NumRows > 0 && NumCols > 0, "Keymap must have atleast one button!");
+    static_assert(NumLayers > 0, "Keymap must have atleast one layer!");
+
+    /** Type of the key codes */
+    using       CodeType = Code;
+
+    /** Number of rows on the keypad */
+    static constexpr uint32_t Rows = NumRows;
+    /** Number of columns on the keypad */
+    static constexpr uint32_t Cols = NumCols;
+    /** Number of layers in the table */
+    static constexpr uint32_t Layers = NumLayers;
+    /** Number of buttons on each layer */
+    static constexpr uint32_t NumKeys = NumRows * NumCols;
+
+    /** Key code of every button, indexed by (layer * NumRows + row) * NumCols + col */
+    std::array<Code, NumLayers * NumKeys> codes;
+    /** Layer used for long-presses and repeats (NumLayers if they use the same layer as the other events) */
+    uint32_t            shiftLayer {NumLayers};
+
+    /**
+     * @brief               Returns the key code of a button
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param r             Row of the button
+     * @param c             Column of the button
+     * @param layer         Layer to use
+     *
+     * @return              Key code of the button on the layer
+     *
+     */
+    constexpr Code lookup(uint32_t r, uint32_t c, uint32_t layer = 0) const {
+        return codes[(layer * NumRows + r) * NumCols + c];
+    }
+
+    /**
+     * @brief               Returns the key code of the button of an event
+     *
+     * @remark              Long-presses and repeats use the shift layer (if one is set) instead of the given layer
+     *                      (a button only repeats after being long-pressed)
+     * @remark              The release of a long-pressed button can not be told apart from the event alone, so it uses
+     *                      the given layer (see KeypadKeymapTranslator, which tracks the long-pressed buttons)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param e             Event
+     * @param layer         Layer to use
+     *
+     * @return              Key code of the button of the event
+     *
+     */
+    constexpr Code lookup(const keypad_event &e, uint32_t layer = 0) const {
+        return lookup(e.r, e.c, ((keypad_event_type(e) == KeypadEventType::LONGPRESS ||
+                                  keypad_event_type(e) == KeypadEventType::REPEAT) && shiftLayer < NumLayers)
+                                    ? shiftLayer : layer);
+    }
+};
+
+/**
+ * @brief                   Callback for every event that translates the button of each event into its key code, and
+ *                          calls a callback with the code instead of the coordinates
+ *
+ * @remark                  The translator tracks the buttons that are long-pressed, so that every event of a button
+ *                          from its long-press until its release (its repeats and its release) uses the shift layer
+ * @remark                  Register it with KeypadBase::register_onevent() (using KeypadKeymapTranslator::handler()),
+ *                          so that the translation happens on the dispatch thread, for example -
+ *                          KeypadKeymapTranslator<decltype(keymap)> translator(keymap, callback(on_key));
+ *                          keypad.register_onevent(translator.handler());
+ *
+ * @tparam Keymap           Type of the keymap (see KeypadKeymap)
+ */
+template <typename Keymap>
+class KeypadKeymapTranslator {
+
+    /** Keymap used to translate the buttons */
+    const Keymap        &keymap;
+    /** Callback function that is called with the type of every event and the key code of its button */
+    Callback<void(KeypadEventType, typename Keymap::CodeType)> onKey;
+
+    /** Layer used for the events that do not use the shift layer */
+    uint32_t            layer {0};
+    /** Bitmask of the long-pressed buttons of each row (only used by the dispatch thread) */
+    uint32_t            shifted[Keymap::Rows] {};
+
+public:
+
+    KeypadKeymapTranslator() = delete;
+
+    /**
+     * @brief               Construct a new translator
+     *
+     * @param map           Keymap used to translate the buttons (must outlive the object)
+     * @param cb            Callback function, the first argument is the type of the event and the second one is the
+     *                      key code of its button
+     *
+     */
+    KeypadKeymapTranslator(const Keymap &map, Callback<void(KeypadEventType, typename Keymap::CodeType)> cb)
+            : keymap(map)
+            , onKey(std::move(cb))
+    {
+    }
+
+    /**
+     * @brief               Selects the layer used for the events that do not use the shift layer
+     *
+     * @remark              Must be called from the thread that dispatches the events (such as from the callback)
+     *
+     * @param l             Layer to use
+     *
+     */
+    void        set_layer(uint32_t l) {
+        layer = l;
+    }
+
+    /**
+     * @brief               Returns the callback function to register for every event
+     *
+     * @return              Callback function that translates an event and calls the callback with its key code
+     *
+     */
+    Callback<void(keypad_event)> handler() {
+        return callback(this, &KeypadKeymapTranslator::translate);
+    }
+
+    /**
+     * @brief               Translates an event and calls the callback with its key code
+     *
+     * @param e             Event
+     *
+     */
+    void        translate(keypad_event e) {
+
+        // a press starts a new hold and a release ends it, the events in between are shifted once it is long-pressed
+
+        const auto bit = 1U << e.c;
+        const auto type = keypad_event_type(e);
+
+        if (type == KeypadEventType::LONGPRESS) {
+            shifted[e.r] |= bit;
+        }
+        else if (type == KeypadEventType::PRESS) {
+            shifted[e.r] &= ~bit;
+        }
+
+        const bool shift = (shifted[e.r] & bit) != 0 && keymap.shiftLayer < Keymap::Layers;
+        const auto code = keymap.lookup(e.r, e.c, shift ? keymap.shiftLayer : layer);
+
+        if (type == KeypadEventType::RELEASE || type == KeypadEventType::CANCEL) {
+            shifted[e.r] &= ~bit;
+        }
+
+        onKey(type, code);
+    }
+};
+
+#endif //__KEYPADKEYMAP_H__
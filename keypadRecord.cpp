@@ -0,0 +1,174 @@
+#include "keypadRecord.h"
+
+/** Number of bytes read out of the ring at a time while flushing it */
+constexpr uint32_t FLUSH_CHUNK_LEN = 32;
+
+namespace {
+
+/**
+ * @brief                   Encodes a value as a varint
+ *
+ * @return                  Number of bytes written
+ *
+ */
+uint32_t
+put_varint(uint8_t *data, uint32_t value) {
+
+    uint32_t n = 0;
+    while (value >= 0x80) {
+        data[n++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+
+    data[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+/**
+ * @brief                   Decodes a varint
+ *
+ * @return                  true if a value was decoded, false if the data ended before the value did
+ *
+ */
+bool
+get_varint(const uint8_t *&pos, const uint8_t *end, uint32_t &value) {
+
+    value = 0;
+    for (uint32_t shift = 0; pos != end && shift < 35; shift += 7) {
+
+        const uint8_t b = *pos++;
+        value |= static_cast<uint32_t>(b & 0x7F) << shift;
+
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+void
+KeypadRecorder::start() {
+
+    CriticalSectionLock lock;
+    lastUs = us_ticker_read();
+}
+
+bool
+KeypadRecorder::record(KeypadRecordKind kind, KeypadEventType type, uint32_t r, uint32_t c) {
+
+    // the record is encoded and its time is taken within the critical section, so that records pushed by ISRs that
+    // preempt each other are still in order of time
+    // a dropped record does not move the time of the latest record, so the next record carries its time as well
+
+    CriticalSectionLock lock;
+
+    const uint32_t nowUs = us_ticker_read();
+    const uint32_t fields = static_cast<uint32_t>(kind) | (static_cast<uint32_t>(type) << 3) | (r << 6) | (c << 11);
+
+    uint8_t bytes[KEYPAD_RECORD_MAX_LEN];
+    uint32_t n = put_varint(bytes, nowUs - lastUs);
+    n += put_varint(bytes + n, fields);
+
+    const uint32_t curTail = tail;
+    if (mask + 1 - (curTail - head) < n) {
+
+        ++dropped;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        buffer[(curTail + i) & mask] = bytes[i];
+    }
+
+    tail = curTail + n;
+    lastUs = nowUs;
+
+    return true;
+}
+
+uint32_t
+KeypadRecorder::read(uint8_t *data, uint32_t len) {
+
+    const uint32_t curHead = head;
+    const uint32_t avail = tail - curHead;
+    const uint32_t n = (len < avail) ? len : avail;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        data[i] = buffer[(curHead + i) & mask];
+    }
+
+    head = curHead + n;
+    return n;
+}
+
+uint32_t
+KeypadRecorder::size() const {
+    return tail - head;
+}
+
+uint32_t
+KeypadRecorder::capacity() const {
+    return mask + 1;
+}
+
+uint32_t
+KeypadRecorder::get_dropped() const {
+    return core_util_atomic_load_u32(&dropped);
+}
+
+void
+KeypadRecorder::set_sink(FileHandle *file) {
+    sink = file;
+}
+
+bool
+KeypadRecorder::has_sink() const {
+    return sink != nullptr;
+}
+
+bool
+KeypadRecorder::flush() {
+
+    FileHandle *file = sink;
+    if (file == nullptr) {
+        return true;
+    }
+
+    uint8_t chunk[FLUSH_CHUNK_LEN];
+    uint32_t n;
+
+    while ((n = read(chunk, FLUSH_CHUNK_LEN)) != 0) {
+        if (file->write(chunk, n) != static_cast<ssize_t>(n)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+KeypadRecorder::decode(const uint8_t *&pos, const uint8_t *end, keypad_record *rec) {
+
+    uint32_t deltaUs;
+    uint32_t fields;
+
+    if (!get_varint(pos, end, deltaUs) || !get_varint(pos, end, fields)) {
+        return false;
+    }
+
+    if ((fields & 0x07) > static_cast<uint32_t>(KeypadRecordKind::KEY_UP) ||
+        ((fields >> 3) & 0x07) > static_cast<uint32_t>(KeypadEventType::REPEAT) || fields > 0xFFFF) {
+        return false;
+    }
+
+    rec->deltaUs = deltaUs;
+    rec->kind = static_cast<KeypadRecordKind>(fields & 0x07);
+    rec->type = static_cast<KeypadEventType>((fields >> 3) & 0x07);
+    rec->r = static_cast<uint8_t>((fields >> 6) & 0x1F);
+    rec->c = static_cast<uint8_t>((fields >> 11) & 0x1F);
+
+    return true;
+}
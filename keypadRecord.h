@@ -0,0 +1,233 @@
+/**
+ * @file                    keypadRecord.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Compact binary log of the raw input and the events of a keypad, for field diagnostics
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADRECORD_H__
+#define __KEYPADRECORD_H__
+
+#include "mbed.h"
+
+#include "keypadEvents.h"
+
+/** Largest number of bytes a single record takes in the log */
+constexpr uint32_t  KEYPAD_RECORD_MAX_LEN   = 8;
+
+/**
+ * @brief                   Enumeration of the kinds of records in the log of a keypad
+ *
+ */
+enum class KeypadRecordKind : uint8_t {
+
+    /** An event was generated (its type is stored in the record) */
+    EVENT,
+    /** A column fell (only in the edge driven modes, the row is always 0) */
+    COLUMN_FALL,
+    /** A column rose (only in the edge driven modes, the row is always 0) */
+    COLUMN_RISE,
+    /** A button was found to be held down by a scan, that was released in the previous scan (only in the per-button
+        modes) */
+    KEY_DOWN,
+    /** A button was found to be released by a scan, that was held down in the previous scan (only in the per-button
+        modes) */
+    KEY_UP
+};
+
+/**
+ * @brief                   Structure to hold a single record decoded from the log of a keypad
+ *
+ */
+struct keypad_record {
+
+    /** Time (in microseconds) since the previous record (or since recording started) */
+    uint32_t            deltaUs;
+    /** Kind of the record */
+    KeypadRecordKind    kind;
+    /** Type of the event (only valid for KeypadRecordKind::EVENT) */
+    KeypadEventType     type;
+    /** Row of the button */
+    uint8_t             r;
+    /** Column of the button */
+    uint8_t             c;
+};
+
+/**
+ * @brief                   Lock-free ring of bytes that holds the log of a keypad, encoded as varints
+ *
+ * @remark                  Each record is the time since the previous record followed by its kind, type, row and column
+ *                          packed into 16 bits, each encoded as a varint (7 bits per byte, lowest bits first, the top
+ *                          bit of a byte is set if more bytes follow), so most records take 3 to 4 bytes
+ * @remark                  A record is never split, if it does not fit in the ring it is dropped (and counted), and its
+ *                          time is carried over to the next record, so recording never blocks the input path
+ * @remark                  The ring is attached to a keypad through Keypad::set_recorder(), and can either be read by the
+ *                          application, or flushed to a FileHandle (such as a file on a filesystem on a BlockDevice) on
+ *                          the dispatch thread of the keypad, which happens every time the events are dispatched and
+ *                          whenever the ring is half full
+ * @remark                  The log can be fed back into a keypad through Keypad::replay()
+ *
+ * @attention               The records are pushed by the ISRs of the keypad (serialized with a critical section), and
+ *                          must only be read (or flushed) from a single thread
+ *
+ */
+class KeypadRecorder {
+
+    /** Storage of the ring */
+    uint8_t             *const buffer;
+    /** Length of the ring minus one (the length is a power of 2) */
+    const uint32_t      mask;
+
+    /** Index at which the next byte is pushed (only written by the producers) */
+    volatile uint32_t   tail {0};
+    /** Index from which the next byte is read (only written by the consumer) */
+    volatile uint32_t   head {0};
+
+    /** Time (in microseconds) of the latest record that was pushed */
+    uint32_t            lastUs {0};
+    /** Number of records that were dropped because the ring was full */
+    uint32_t            dropped {0};
+
+    /** File to which the ring is flushed (nullptr if the ring is only read by the application) */
+    FileHandle         *volatile sink {nullptr};
+
+public:
+
+    KeypadRecorder() = delete;
+
+    /**
+     * @brief               Construct a new ring on a user-supplied buffer
+     *
+     * @tparam Len          Length of the buffer (must be a power of 2)
+     *
+     * @param storage       Buffer to store the log in (must outlive the object)
+     *
+     */
+    template <uint32_t Len>
+    explicit KeypadRecorder(uint8_t (&storage)[Len])
+            : buffer(storage)
+            , mask(Len - 1)
+    {
+        static_assert(Len >= KEYPAD_RECORD_MAX_LEN, "Log must be able to hold atleast one record!");
+        static_assert((Len & (Len - 1)) == 0, "Log length must be a power of 2!");
+    }
+
+    /**
+     * @brief               Starts recording, so that the first record carries the time since now
+     *
+     * @remark              Called by Keypad::set_recorder() when the log is attached (the bytes already in the log are
+     *                      kept)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     */
+    void        start();
+
+    /**
+     * @brief               Appends a record to the log
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param kind          Kind of the record
+     * @param type          Type of the event (only used for KeypadRecordKind::EVENT)
+     * @param r             Row of the button
+     * @param c             Column of the button
+     *
+     * @return              true if the record was appended, false if it was dropped because the ring is full
+     *
+     */
+    bool        record(KeypadRecordKind kind, KeypadEventType type, uint32_t r, uint32_t c);
+
+    /**
+     * @brief               Removes bytes from the start of the log
+     *
+     * @remark              The bytes are returned in order, but a record may be split across two calls
+     *
+     * @param data          Location where the bytes are stored
+     * @param len           Maximum number of bytes to remove
+     *
+     * @return              Number of bytes removed
+     *
+     */
+    uint32_t    read(uint8_t *data, uint32_t len);
+
+    /**
+     * @brief               Returns the number of bytes in the log
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of bytes that are yet to be read
+     *
+     */
+    uint32_t    size() const;
+
+    /**
+     * @brief               Returns the number of bytes the log can hold
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Length of the ring
+     *
+     */
+    uint32_t    capacity() const;
+
+    /**
+     * @brief               Returns the number of records that were dropped because the ring was full
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              Number of dropped records
+     *
+     */
+    uint32_t    get_dropped() const;
+
+    /**
+     * @brief               Sets the file to which the log is flushed on the dispatch thread of the keypad
+     *
+     * @param file          File to flush to (must outlive the object), nullptr to stop flushing
+     *
+     */
+    void        set_sink(FileHandle *file);
+
+    /**
+     * @brief               Checks if the log is flushed to a file
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @return              true if a file was set, false otherwise
+     *
+     */
+    bool        has_sink() const;
+
+    /**
+     * @brief               Writes the bytes in the log to the file (does nothing if no file was set)
+     *
+     * @remark              Called by the dispatch thread of the keypad, but can also be called by the application (as
+     *                      long as it is the only thread reading the log)
+     * @remark              The records pushed by the ISRs while the file is being written may be left in the log, and
+     *                      are written by the next flush (the file is not complete until recording is stopped and the
+     *                      log is flushed once more)
+     *
+     * @return              true if every byte was written, false if the file did not accept all of them (the rest is
+     *                      lost)
+     *
+     */
+    bool        flush();
+
+    /**
+     * @brief               Decodes the next record of a log
+     *
+     * @param pos           Position of the next record (advanced past it)
+     * @param end           End of the log
+     * @param rec           Location where the record is stored
+     *
+     * @return              true if a record was decoded, false if the log ended or the record is malformed
+     *
+     */
+    static bool decode(const uint8_t *&pos, const uint8_t *end, keypad_record *rec);
+};
+
+#endif //__KEYPADRECORD_H__
@@ -0,0 +1,168 @@
+#include "keypadSequence.h"
+
+bool
+KeypadSequence::register_onmatch(Callback<void(uint32_t)> cb) {
+    return onMatch.attach(std::move(cb));
+}
+
+void
+KeypadSequence::remove_onmatch() {
+    onMatch.detach();
+}
+
+bool
+KeypadSequence::is_onmatch_registered() const {
+    return onMatch.is_attached();
+}
+
+void
+KeypadSequence::reset() {
+
+    toExpire.detach();
+    armed = armed + 1;
+
+    state = 0;
+    deferred = KEYPAD_SEQUENCE_NONE;
+    withheld = KEYPAD_SEQUENCE_NONE;
+}
+
+bool
+KeypadSequence::uses(KeypadEventType type) const {
+    return (types & (1U << static_cast<uint32_t>(type))) != 0;
+}
+
+void
+KeypadSequence::feed(const keypad_event &e) {
+
+    // find the longest prefix that the event extends, starting with the current one and falling back to its suffixes
+    // a deferred sequence is kept while the events extend the current prefix, dropped once a longer sequence ends at
+    // the prefix, and reported as soon as an event does not extend it
+    // a sequence that ends at the new prefix (or at one of its suffixes) is reported right away, unless a step with a
+    // window may still extend it, in which case it is deferred until the window runs out
+
+    if (!uses(keypad_event_type(e))) {
+        return;
+    }
+
+    const auto elapsedMs = static_cast<uint16_t>(e.time - lastMs);
+    lastMs = static_cast<uint16_t>(e.time);
+
+    uint32_t n = state;
+    uint32_t next = 0;
+
+    for (;;) {
+
+        for (uint32_t v = nodes[n].child; v != 0; v = nodes[v].sibling) {
+
+            const auto &s = nodes[v].step;
+            if (s.type == keypad_event_type(e) && s.r == e.r && s.c == e.c &&
+                (n == 0 || s.windowMs == 0 || elapsedMs <= s.windowMs)) {
+
+                next = v;
+                break;
+            }
+        }
+
+        if (next != 0 || n == 0) {
+            break;
+        }
+        n = nodes[n].fail;
+    }
+
+    if (n != state || next == 0) {
+        report_deferred();
+    }
+
+    state = next;
+
+    const auto &node = nodes[state];
+    const uint32_t match = (node.match != KEYPAD_SEQUENCE_NONE) ? node.match : nodes[node.output].match;
+
+    if (match != KEYPAD_SEQUENCE_NONE) {
+
+        // a sequence that only ends at a suffix started after the deferred one, and is held back behind it, while one
+        // that ends at the prefix itself is the longer sequence, which supersedes both
+
+        if (deferred != KEYPAD_SEQUENCE_NONE && node.match == KEYPAD_SEQUENCE_NONE) {
+            withheld = match;
+        }
+        else {
+
+            deferred = KEYPAD_SEQUENCE_NONE;
+            withheld = KEYPAD_SEQUENCE_NONE;
+
+            if (node.child != 0 && node.timeoutMs != 0) {
+                deferred = match;
+            }
+            else {
+                report(match);
+            }
+        }
+    }
+
+    // the timer is re-armed for the new prefix, and is detached before the count changes, so that an expiry of the
+    // previous one either runs before (and is ignored) or not at all
+
+    toExpire.detach();
+    armed = armed + 1;
+
+    if (node.timeoutMs != 0) {
+        toExpire.attach(callback(this, &KeypadSequence::expire_handler), std::chrono::milliseconds(node.timeoutMs));
+    }
+}
+
+void
+KeypadSequence::poll() {
+
+    if (expired != armed) {
+        return;
+    }
+
+    // mark the expiry as handled, so that draining again does not report it again
+
+    armed = armed + 1;
+
+    // the events followed so far may still be the start of a sequence through one of the suffixes of the prefix, as
+    // long as none of its next steps has a window
+
+    uint32_t n = nodes[state].fail;
+    while (n != 0 && nodes[n].timeoutMs != 0) {
+        n = nodes[n].fail;
+    }
+    state = n;
+
+    report_deferred();
+}
+
+void
+KeypadSequence::expire_handler() {
+
+    expired = armed;
+
+    KeypadBase *keypad = owner;
+    if (keypad != nullptr) {
+        keypad->post_drain();
+    }
+}
+
+void
+KeypadSequence::report(uint32_t id) {
+    onMatch.call(id);
+}
+
+void
+KeypadSequence::report_deferred() {
+
+    const auto first = deferred;
+    const auto second = withheld;
+
+    deferred = KEYPAD_SEQUENCE_NONE;
+    withheld = KEYPAD_SEQUENCE_NONE;
+
+    if (first != KEYPAD_SEQUENCE_NONE) {
+        report(first);
+    }
+    if (second != KEYPAD_SEQUENCE_NONE) {
+        report(second);
+    }
+}
@@ -0,0 +1,415 @@
+/**
+ * @file                    keypadSequence.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Incremental recognizer of sequences of events (combos, double-taps and PIN entry)
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADSEQUENCE_H__
+#define __KEYPADSEQUENCE_H__
+
+#include "keypad.h"
+
+/** Identifier of no sequence */
+constexpr uint32_t  KEYPAD_SEQUENCE_NONE    = 0xFF;
+
+/**
+ * @brief                   Structure to hold a single step of a sequence
+ *
+ */
+struct keypad_sequence_step {
+
+    /** Type of the event */
+    KeypadEventType     type;
+    /** Row of the button */
+    uint8_t             r;
+    /** Column of the button */
+    uint8_t             c;
+    /** Longest time (in milliseconds) since the previous step of the sequence, 0 if there is no limit (ignored for the
+        first step) */
+    uint16_t            windowMs {0};
+};
+
+/**
+ * @brief                   Structure to hold a single node of the automaton of a KeypadSequenceTable
+ *
+ * @remark                  Each node is the prefix of one or more sequences, and is reached through the last step of the
+ *                          prefix (node 0 is the empty prefix)
+ *
+ */
+struct keypad_sequence_node {
+
+    /** Last step of the prefix */
+    keypad_sequence_step step {KeypadEventType::PRESS, 0, 0, 0};
+    /** First node whose prefix extends this one by a single step (0 if there is none) */
+    uint8_t             child {0};
+    /** Next node that extends the same prefix as this one (0 if there is none) */
+    uint8_t             sibling {0};
+    /** Node of the longest proper suffix of the prefix that is also a prefix of a sequence */
+    uint8_t             fail {0};
+    /** Identifier of the sequence that ends at this node (KEYPAD_SEQUENCE_NONE if no sequence does) */
+    uint8_t             match {KEYPAD_SEQUENCE_NONE};
+    /** Nearest node on the chain of suffixes at which a sequence ends (0 if there is none) */
+    uint8_t             output {0};
+    /** Time (in milliseconds) after which none of the steps that extend the prefix can follow, 0 if there is no such
+        time */
+    uint16_t            timeoutMs {0};
+};
+
+/**
+ * @brief                   Automaton that recognizes a set of sequences, built at compile time
+ *
+ * @remark                  The sequences are stored as a trie of their prefixes, where every node also links to the node
+ *                          of its longest suffix (as in Aho-Corasick), so that a sequence is recognized even if it
+ *                          starts in the middle of a failed attempt, and following a single event costs a walk over the
+ *                          steps that extend the current prefix (and its suffixes, if none of them match)
+ * @remark                  The automaton is built by make_keypad_sequences() and is an aggregate, so declaring it as a
+ *                          constexpr object places it in flash, for example -
+ *                          constexpr keypad_sequence_step pin[] {{KeypadEventType::PRESS, 0, 0},
+ *                                                                {KeypadEventType::PRESS, 0, 1}};
+ *                          constexpr keypad_sequence_step doubleTap[] {{KeypadEventType::PRESS, 3, 3},
+ *                                                                      {KeypadEventType::PRESS, 3, 3, 300}};
+ *                          constexpr auto sequences = make_keypad_sequences<8>(pin, doubleTap);
+ *                          static_assert(!sequences.overflow, "Too many steps!");
+ *
+ * @tparam MaxNodes         Largest number of nodes in the automaton (atmost one per step of every sequence, plus one)
+ */
+template <uint32_t MaxNodes>
+struct KeypadSequenceTable {
+
+    static_assert(MaxNodes > 1, "Sequence table must have atleast one step!");
+    static_assert(MaxNodes <= 255, "Sequence table can not have more than 255 nodes!");
+
+    /** Nodes of the automaton (node 0 is the empty prefix) */
+    keypad_sequence_node nodes[MaxNodes] {};
+    /** Number of nodes in use */
+    uint32_t            numNodes {1};
+    /** Bitmask of the types of events used by any step (bit t corresponds to the KeypadEventType with value t) */
+    uint32_t            types {0};
+    /** Whether any step was left out because MaxNodes is too small */
+    bool                overflow {false};
+
+    /**
+     * @brief               Adds a sequence to the trie
+     *
+     * @param steps         Steps of the sequence
+     * @param len           Number of steps
+     * @param id            Identifier of the sequence
+     *
+     */
+    constexpr void add(const keypad_sequence_step *steps, uint32_t len, uint32_t id) {
+
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < len; ++i) {
+
+            uint32_t next = find(n, steps[i]);
+
+            if (next == 0) {
+
+                if (numNodes == MaxNodes) {
+
+                    overflow = true;
+                    return;
+                }
+
+                next = numNodes++;
+                nodes[next].step = steps[i];
+                nodes[next].sibling = nodes[n].child;
+                nodes[n].child = static_cast<uint8_t>(next);
+            }
+
+            types |= 1U << static_cast<uint32_t>(steps[i].type);
+            n = next;
+        }
+
+        if (n != 0 && nodes[n].match == KEYPAD_SEQUENCE_NONE) {
+            nodes[n].match = static_cast<uint8_t>(id);
+        }
+    }
+
+    /**
+     * @brief               Links every node to its longest suffix, and finds the time after which it can not be extended
+     *
+     * @remark              The nodes are visited in order of the length of their prefix, so that the suffixes of a node
+     *                      are linked before it is
+     *
+     */
+    constexpr void link() {
+
+        uint8_t order[MaxNodes] {};
+        uint32_t head = 0;
+        uint32_t tail = 0;
+
+        for (uint32_t v = nodes[0].child; v != 0; v = nodes[v].sibling) {
+            order[tail++] = static_cast<uint8_t>(v);
+        }
+
+        while (head != tail) {
+
+            const uint32_t u = order[head++];
+
+            for (uint32_t v = nodes[u].child; v != 0; v = nodes[v].sibling) {
+
+                uint32_t f = nodes[u].fail;
+                while (f != 0 && find(f, nodes[v].step) == 0) {
+                    f = nodes[f].fail;
+                }
+
+                const uint32_t g = find(f, nodes[v].step);
+                nodes[v].fail = static_cast<uint8_t>((g != v) ? g : 0);
+
+                const auto &s = nodes[nodes[v].fail];
+                nodes[v].output = (s.match != KEYPAD_SEQUENCE_NONE) ? nodes[v].fail : s.output;
+
+                order[tail++] = static_cast<uint8_t>(v);
+            }
+        }
+
+        // a prefix only times out if every step that extends it has a window
+
+        for (uint32_t u = 1; u < numNodes; ++u) {
+
+            uint32_t timeout = 0;
+            for (uint32_t v = nodes[u].child; v != 0; v = nodes[v].sibling) {
+
+                if (nodes[v].step.windowMs == 0) {
+
+                    timeout = 0;
+                    break;
+                }
+                timeout = (nodes[v].step.windowMs > timeout) ? nodes[v].step.windowMs : timeout;
+            }
+
+            nodes[u].timeoutMs = static_cast<uint16_t>(timeout);
+        }
+    }
+
+    /**
+     * @brief               Finds the node that extends a prefix by a step
+     *
+     * @param n             Node of the prefix
+     * @param step          Step (its window is not compared)
+     *
+     * @return              Node that extends the prefix, 0 if there is none
+     *
+     */
+    constexpr uint32_t find(uint32_t n, const keypad_sequence_step &step) const {
+
+        for (uint32_t v = nodes[n].child; v != 0; v = nodes[v].sibling) {
+
+            const auto &s = nodes[v].step;
+            if (s.type == step.type && s.r == step.r && s.c == step.c) {
+                return v;
+            }
+        }
+
+        return 0;
+    }
+};
+
+/**
+ * @brief                   Builds the automaton that recognizes a set of sequences
+ *
+ * @remark                  The sequences are identified by their position in the arguments (from 0), and if the same
+ *                          sequence is passed twice, only the first one is recognized
+ *
+ * @tparam MaxNodes         Largest number of nodes in the automaton (atmost one per step of every sequence, plus one)
+ *
+ * @param sequences         Steps of each sequence
+ *
+ * @return                  Automaton that recognizes the sequences
+ *
+ */
+template <uint32_t MaxNodes, size_t... Lens>
+constexpr KeypadSequenceTable<MaxNodes> make_keypad_sequences(const keypad_sequence_step (&...sequences)[Lens]) {
+
+    static_assert(sizeof...(Lens) < KEYPAD_SEQUENCE_NONE, "Sequence table can not have more than 254 sequences!");
+
+    KeypadSequenceTable<MaxNodes> table {};
+
+    uint32_t id = 0;
+    const int expand[] {0, (table.add(sequences, Lens, id++), 0)...};
+    (void) expand;
+
+    table.link();
+    return table;
+}
+
+/**
+ * @brief                   Class that follows the events of a keypad through a KeypadSequenceTable, and calls a callback
+ *                          whenever a sequence is recognized
+ *
+ * @remark                  The recognizer is attached to a keypad through Keypad::set_sequence(), and is fed every event
+ *                          of a type used by any of its sequences on the dispatch thread, after the callbacks of the
+ *                          keypad (the events are queued even if no callback of the keypad is registered for them), so
+ *                          the callback of a match also runs on the dispatch thread
+ * @remark                  An event that does not extend the current prefix (or, if a step has a window, arrives after
+ *                          its window) falls back to the longest suffix that it does extend, so every event is followed
+ *                          exactly once, and the history of events is never scanned again
+ * @remark                  If a sequence is a prefix of another whose next step has a window (such as a tap and a
+ *                          double-tap), the shorter sequence is deferred until the longer one either ends (and the
+ *                          shorter one is dropped) or fails, because an event does not extend it or a window runs out
+ *                          without the longer one continuing (and the shorter one is reported), which is timed with a
+ *                          KeypadTimeout (the same as the timers of the keypad) that hands the expiry to the dispatch
+ *                          thread
+ * @remark                  A sequence that ends partway through the longer one at a suffix of the prefix followed so far
+ *                          (such as the second tap of a failed double-tap) is held back behind the deferred one, and is
+ *                          reported right after it (only the latest such sequence is kept)
+ * @remark                  Once a window runs out, the recognizer falls back to the longest suffix of the prefix whose
+ *                          next steps have no window (such as the press of a failed double-tap that is also the start of
+ *                          a tap), or starts over if there is none
+ * @remark                  The timer is the recognizer's own, since the keypad is not ticking while its buttons are
+ *                          released (except in KeypadMode::PERIODIC_SCAN), which is exactly when a window runs out, so
+ *                          a keypad with a recognizer arms one more timer, but only while the current prefix has a
+ *                          window (it is detached otherwise)
+ * @remark                  The expiry posts the same call to drain the ring as the events of the keypad (see
+ *                          KeypadBase::post_drain()), so it never adds a call of its own to the queue, and the spare call
+ *                          of each keypad in keypad_dispatch_queue_size() covers it
+ *
+ */
+class KeypadSequence {
+
+    friend class KeypadBase;
+
+    /** Nodes of the automaton (stored in the table) */
+    const keypad_sequence_node *const nodes;
+    /** Bitmask of the types of events used by any step */
+    const uint32_t      types;
+
+    /** Keypad that feeds the recognizer (nullptr if it is not attached) */
+    KeypadBase          *volatile owner {nullptr};
+
+    /** Node of the longest prefix that the latest events match */
+    uint32_t            state {0};
+    /** Time (in milliseconds, as carried by the events) of the latest event that was followed */
+    uint16_t            lastMs {0};
+    /** Sequence that was recognized, but is only reported if the longer sequence that extends it fails */
+    uint32_t            deferred {KEYPAD_SEQUENCE_NONE};
+    /** Sequence that ended at a suffix of the prefix while another one was deferred, reported right after it */
+    uint32_t            withheld {KEYPAD_SEQUENCE_NONE};
+
+    /** Timer that runs out when the current prefix can no longer be extended (only armed while the prefix has a window) */
+    KeypadTimeout       toExpire;
+    /** Number of times the timer was armed (only written by the dispatch thread) */
+    volatile uint32_t   armed {0};
+    /** Value of armed when the timer ran out (only written by the timer) */
+    volatile uint32_t   expired {~0U};
+
+    /** Callback function that is called when a sequence is recognized */
+    KeypadCallback<void(uint32_t)> onMatch;
+
+public:
+
+    KeypadSequence() = delete;
+
+    /**
+     * @brief               Construct a new recognizer that follows an automaton
+     *
+     * @param table         Automaton (must outlive the object, and is usually a constexpr object)
+     *
+     */
+    template <uint32_t MaxNodes>
+    explicit KeypadSequence(const KeypadSequenceTable<MaxNodes> &table)
+            : nodes(table.nodes)
+            , types(table.types)
+    {
+    }
+
+    /**
+     * @brief               Registers a callback function that is called when a sequence is recognized
+     *
+     * @remark              The argument passed to the callback is the identifier of the sequence (its position in the
+     *                      arguments of make_keypad_sequences())
+     *
+     * @remark              The callback can be replaced while the events are being dispatched (see KeypadCallback)
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param cb            Callback function
+     *
+     * @return              true if the callback was registered, false if the callback replaced by the previous call is
+     *                      still being called (in which case the call can be retried once it returns)
+     *
+     */
+    bool        register_onmatch(Callback<void(uint32_t)> cb);
+
+    /**
+     * @brief               Removes the callback function that is called when a sequence is recognized
+     *
+     */
+    void        remove_onmatch();
+
+    /**
+     * @brief               Checks if a callback function is registered on a sequence being recognized
+     *
+     * @return              true if a callback is registered, false otherwise
+     *
+     */
+    bool        is_onmatch_registered() const;
+
+    /**
+     * @brief               Forgets the events followed so far (such as after a wrong PIN), without reporting a deferred
+     *                      sequence
+     *
+     * @attention           This function must be called on the dispatch thread of the keypad (such as from the
+     *                      callback), or while the recognizer is not attached
+     *
+     */
+    void        reset();
+
+    /**
+     * @brief               Checks if events of a type are used by any sequence
+     *
+     * @attention           This function can be called from ISR context
+     *
+     * @param type          Type of the event
+     *
+     * @return              true if any step uses the type, false otherwise
+     *
+     */
+    bool        uses(KeypadEventType type) const;
+
+private:
+
+    /**
+     * @brief               Follows an event through the automaton (called on the dispatch thread)
+     *
+     * @param e             Event
+     *
+     */
+    void        feed (const keypad_event &e);
+
+    /**
+     * @brief               Reports the deferred sequences and falls back to the longest suffix without a window if the
+     *                      timer ran out (called on the dispatch thread)
+     *
+     */
+    void        poll ();
+
+    /**
+     * @brief               Hands the expiry to the dispatch thread
+     *
+     * @attention           This function is called from ISR context
+     *
+     */
+    void        expire_handler ();
+
+    /**
+     * @brief               Calls the callback on a sequence being recognized
+     *
+     * @param id            Identifier of the sequence
+     *
+     */
+    void        report (uint32_t id);
+
+    /**
+     * @brief               Reports the deferred sequence (and the one held back behind it), and forgets both
+     *
+     */
+    void        report_deferred ();
+};
+
+#endif //__KEYPADSEQUENCE_H__
@@ -0,0 +1,215 @@
+/**
+ * @file                    keypadStats.h
+ * @author                  Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ *
+ * @brief                   Statistics collected by a keypad to instrument its behaviour
+ *
+ * @copyright               Copyright (c) 2023
+ *
+ */
+
+#ifndef __KEYPADSTATS_H__
+#define __KEYPADSTATS_H__
+
+#include "mbed.h"
+
+/** Number of buckets in a latency histogram */
+constexpr uint32_t  KEYPAD_LATENCY_BUCKETS      = 12;
+/** Width (in microseconds) of the first bucket of a latency histogram, each further bucket is twice as wide */
+constexpr uint32_t  KEYPAD_LATENCY_BUCKET_US    = 64;
+
+/**
+ * @brief                   Structure to hold a snapshot of the counters of a keypad
+ *
+ */
+struct keypad_counters {
+
+    /** Number of events whose callbacks were called on the dispatch thread */
+    uint32_t            delivered;
+    /** Number of events that were dropped because the ring was full */
+    uint32_t            dropped;
+    /** Number of times a call to drain the ring could not be posted because the event queue was full (the events are
+        delayed until the next event is generated, not lost) */
+    uint32_t            postFailures;
+    /** Number of unconsumed events that were overwritten because the stream was full (only counted by KeypadBlocking) */
+    uint32_t            overwritten;
+    /** Number of presses (and releases in the per-button modes) that were rejected while debouncing */
+    uint32_t            bouncesRejected;
+    /** Number of presses that were rejected because another button was held down (only in KeypadMode::SINGLE_KEY) */
+    uint32_t            concurrentRejected;
+    /** Number of times an ambiguous combination of buttons (ghosting) started being suppressed (only in the per-button
+        modes, see Keypad::set_diodes()) */
+    uint32_t            ghostsSuppressed;
+    /** Number of events that were discarded because their button was not subscribed to their type (see
+        Keypad::set_subscribed()) */
+    uint32_t            filtered;
+};
+
+/**
+ * @brief                   Structure to accumulate the distribution of a latency (in microseconds)
+ *
+ * @remark                  Bucket 0 counts the samples below KEYPAD_LATENCY_BUCKET_US, bucket i counts the samples in
+ *                          [KEYPAD_LATENCY_BUCKET_US << (i - 1), KEYPAD_LATENCY_BUCKET_US << i), and the last bucket also
+ *                          counts every sample above its range
+ *
+ */
+struct keypad_latency_stats {
+
+    /** Number of samples */
+    uint32_t            count;
+    /** Smallest sample (only valid if count is not 0) */
+    uint32_t            min;
+    /** Largest sample (only valid if count is not 0) */
+    uint32_t            max;
+    /** Sum of all the samples */
+    uint64_t            total;
+    /** Number of samples in each bucket of the histogram */
+    uint32_t            buckets[KEYPAD_LATENCY_BUCKETS];
+};
+
+/**
+ * @brief                   Adds a sample to a latency distribution
+ *
+ * @param s                 Distribution
+ * @param us                Latency (in microseconds)
+ *
+ */
+inline void keypad_latency_record(keypad_latency_stats &s, uint32_t us) {
+
+    if (s.count == 0 || us < s.min) {
+        s.min = us;
+    }
+    if (s.count == 0 || us > s.max) {
+        s.max = us;
+    }
+
+    ++s.count;
+    s.total += us;
+
+    uint32_t bucket = 0;
+    for (auto v = us / KEYPAD_LATENCY_BUCKET_US; v != 0 && bucket < KEYPAD_LATENCY_BUCKETS - 1; v >>= 1) {
+        ++bucket;
+    }
+
+    ++s.buckets[bucket];
+}
+
+/**
+ * @brief                   Returns the average of a latency distribution
+ *
+ * @param s                 Distribution
+ *
+ * @return                  Average latency (in microseconds), 0 if there are no samples
+ *
+ */
+inline uint32_t keypad_latency_avg(const keypad_latency_stats &s) {
+    return (s.count == 0) ? 0 : static_cast<uint32_t>(s.total / s.count);
+}
+
+#if defined(KEYPAD_ISR_STATS)
+
+/**
+ * @brief                   Enumeration of the interrupt handlers of a keypad that are profiled
+ *
+ * @remark                  In KeypadMode::ROLLOVER the column edges are only accounted to MATRIX_EDGE (the edge
+ *                          handlers forward to it), so that no handler is accounted inside another one
+ *
+ */
+enum class KeypadIsr : uint8_t {
+
+    /** Falling edge on a column (Keypad::fall_handler()) */
+    FALL,
+    /** Rising edge on a column (Keypad::rise_handler()) */
+    RISE,
+    /** End of the debounce window of a press, which scans the rows (Keypad::row_scan_handler()) */
+    ROW_SCAN,
+    /** End of the hold off of an eagerly reported press (Keypad::eager_verify_handler()) */
+    EAGER_VERIFY,
+    /** End of the debounce window of a release (Keypad::button_scan_handler()) */
+    BUTTON_SCAN,
+    /** End of the long-press threshold (Keypad::long_press_handler()) */
+    LONG_PRESS,
+    /** Auto-repeat of a held down button (Keypad::repeat_handler()) */
+    REPEAT,
+    /** Edge on a column in KeypadMode::ROLLOVER (Keypad::matrix_edge_handler()) */
+    MATRIX_EDGE,
+    /** Scan of the matrix in KeypadMode::ROLLOVER (Keypad::matrix_scan_handler()) */
+    MATRIX_SCAN,
+    /** Tick of KeypadMode::PERIODIC_SCAN (Keypad::periodic_scan_handler()) */
+    PERIODIC_SCAN,
+    /** Scan supplied by the application in KeypadMode::EXTERNAL_SCAN (Keypad::process_scan()) */
+    EXTERNAL_SCAN
+};
+
+/** Number of interrupt handlers that are profiled */
+constexpr uint32_t  KEYPAD_ISR_COUNT    = static_cast<uint32_t>(KeypadIsr::EXTERNAL_SCAN) + 1;
+
+/**
+ * @brief                   Structure to accumulate the cycles spent in an interrupt handler
+ *
+ */
+struct keypad_isr_stats {
+
+    /** Number of times the handler ran */
+    uint32_t            count;
+    /** Most cycles spent in a single run of the handler */
+    uint32_t            max;
+    /** Cycles spent in every run of the handler */
+    uint64_t            total;
+};
+
+#if defined(KEYPAD_CYCLE_COUNTER)
+// the counter was supplied by the application (as an expression that evaluates to a free running 32-bit count of
+// SystemCoreClock ticks)
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__)
+#define KEYPAD_CYCLE_COUNTER()  (DWT->CYCCNT)
+#define KEYPAD_CYCLE_COUNTER_DWT
+#else
+// cores without a DWT cycle counter (such as the Cortex-M0/M0+) fall back to the microsecond ticker, the counts are
+// still in cycles but only have a resolution of a microsecond
+#define KEYPAD_CYCLE_COUNTER()  (us_ticker_read() * (SystemCoreClock / 1000000U))
+#endif
+
+/**
+ * @brief                   Starts the cycle counter (does nothing unless the DWT cycle counter is used)
+ *
+ * @remark                  The DWT is shared with debuggers and other profilers, which may also start (but should not
+ *                          stop or reset) the counter
+ *
+ */
+inline void keypad_cycles_enable() {
+
+#if defined(KEYPAD_CYCLE_COUNTER_DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(__CORE_CM7_H_GENERIC)
+    DWT->LAR = 0xC5ACCE55;
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief                   Returns the current value of the cycle counter
+ *
+ * @attention               This function can be called from ISR context
+ *
+ */
+inline uint32_t keypad_cycles() {
+    return KEYPAD_CYCLE_COUNTER();
+}
+
+/**
+ * @brief                   Converts a number of cycles into microseconds (to report them alongside the latencies)
+ *
+ * @param cycles            Number of cycles
+ *
+ * @return                  Time (in microseconds), rounded down
+ *
+ */
+inline uint32_t keypad_cycles_to_us(uint64_t cycles) {
+    return static_cast<uint32_t>(cycles / (SystemCoreClock / 1000000U));
+}
+
+#endif
+
+#endif